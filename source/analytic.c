@@ -0,0 +1,249 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <time.h>
+#include "config.h"
+#include "analytic.h"
+
+static double mean_uniform(int min, int max);
+static void solve_station(struct analytic_station * st, double lambda);
+static void record_closed(struct analytic * a, FILE * stats_file);
+static void record_delay(struct analytic * a, FILE * stats_file);
+
+/* Function to solve the cpu/disk network described by conf. Every station is
+ * treated as an M/M/c queue in an open Jackson network. Jobs visit the cpu
+ * 1 / QUIT_PROB times, and the disk visits in between are split between the
+ * disks in proportion to their service rates, which is where shortest queue
+ * routing tends to balance them.
+ */
+struct analytic * init_analytic(struct config * conf)
+{
+	struct timespec start;
+	struct timespec end;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	struct analytic * a = malloc(sizeof(struct analytic));
+	struct analytic_station * cpu = &a->st[0];
+	struct analytic_station * d1 = &a->st[1];
+	struct analytic_station * d2 = &a->st[2];
+
+	cpu->name = "CPU";
+	cpu->servers = conf->cpu_servers;
+	cpu->service_t = mean_uniform(conf->cpu_min, conf->cpu_max);
+	d1->name = "Disk1";
+	d1->servers = conf->disk1_servers;
+	/* calc_job_time starts disk1 times from DISK2_MIN rather than DISK1_MIN,
+	 * so the mean does too, or the two would not agree */
+	d1->service_t = mean_uniform(conf->disk1_min, conf->disk1_max)
+		- conf->disk1_min + conf->disk2_min;
+	d2->name = "Disk2";
+	d2->servers = conf->disk2_servers;
+	d2->service_t = mean_uniform(conf->disk2_min, conf->disk2_max);
+
+	/* A job that never quits never leaves, so every station saturates */
+	if (conf->quit_prob > 0) {
+		cpu->visits = 1 / conf->quit_prob;
+	} else {
+		cpu->visits = 1e300;
+	}
+	double disk_visits = cpu->visits - 1;
+	double d1_rate = d1->servers / d1->service_t;
+	double d2_rate = d2->servers / d2->service_t;
+	d1->visits = disk_visits * d1_rate / (d1_rate + d2_rate);
+	d2->visits = disk_visits - d1->visits;
+
+	a->arrive_rate = 1 / mean_uniform(conf->arrive_min, conf->arrive_max);
+	a->sojourn_t = 0;
+	for (int i = 0; i < ANALYTIC_STATIONS; i++) {
+		solve_station(&a->st[i], a->arrive_rate);
+		a->sojourn_t += a->st[i].visits * a->st[i].resp_t;
+	}
+
+	/* Closed network with the same demands, solved for every population
+	 * up to MVA_POP in a single pass. A station with c servers is split
+	 * into a queue with 1 / c of its demand and a delay holding the rest,
+	 * and the delays are solved as extra think time. A closed system is
+	 * solved the same way, with its own think time, for every population
+	 * up to its own if that is larger, which gives the throughput it would
+	 * have with each number of jobs */
+	a->population = conf->population;
+	a->think_t = 0;
+	a->mva_pop = conf->mva_pop;
+	if (a->population > 0) {
+		a->think_t = mean_uniform(conf->think_min, conf->think_max);
+		if (a->mva_pop < a->population) {
+			a->mva_pop = a->population;
+		}
+	}
+	a->delay = 0;
+	a->mva_x = NULL;
+	a->mva_r = NULL;
+	if (a->mva_pop > 0) {
+		double demands[ANALYTIC_STATIONS];
+		for (int i = 0; i < ANALYTIC_STATIONS; i++) {
+			double d = a->st[i].visits * a->st[i].service_t;
+			demands[i] = d / a->st[i].servers;
+			a->delay += d - demands[i];
+		}
+		a->mva_x = malloc(sizeof(double) * a->mva_pop);
+		a->mva_r = malloc(sizeof(double) * a->mva_pop);
+		solve_mva(demands, ANALYTIC_STATIONS, a->delay + a->think_t,
+				a->mva_pop, a->mva_x, a->mva_r);
+		for (int m = 0; m < a->mva_pop; m++) {
+			*(a->mva_r + m) += a->delay;
+		}
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	a->solve_us = (end.tv_sec - start.tv_sec) * 1e6
+			+ (end.tv_nsec - start.tv_nsec) / 1e3;
+
+	return a;
+}
+
+/* Function to free analytic results */
+void kill_analytic(struct analytic * a)
+{
+	free(a->mva_x);
+	free(a->mva_r);
+	free(a);
+}
+
+/* Mean of the times calc_job_time draws for an interval, which are integers
+ * from min up to but not including max */
+static double mean_uniform(int min, int max)
+{
+	return min + (max - min - 1) / 2.0;
+}
+
+/* Fills in the M/M/c results for a station given the system arrival rate */
+static void solve_station(struct analytic_station * st, double lambda)
+{
+	int c = st->servers;
+	double load = lambda * st->visits * st->service_t;
+
+	st->arrive_rate = lambda * st->visits;
+	st->util = load / c;
+
+	if (st->util >= 1) {
+		st->saturated = true;
+		st->util = 1;
+		st->avg_len = 1.0 / 0.0;
+		st->resp_t = 1.0 / 0.0;
+		st->arrive_rate = c / st->service_t;
+		return;
+	}
+
+	/* Erlang C probability of waiting, built up from Erlang B one server
+	 * at a time so that large c does not overflow */
+	double erlang_b = 1;
+	for (int k = 1; k <= c; k++) {
+		erlang_b = load * erlang_b / (k + load * erlang_b);
+	}
+	double erlang_c = erlang_b / (1 - st->util * (1 - erlang_b));
+
+	st->saturated = false;
+	st->resp_t = st->service_t + erlang_c * st->service_t / (c - load);
+	st->avg_len = st->arrive_rate * st->resp_t;
+}
+
+/* Exact mean value analysis of a closed network of k single server stations
+ * with the given service demands per job and think time. Throughput and
+ * response time for every population from 1 to n are stored in x and r.
+ */
+void solve_mva(double * demands, int k, double think_t, int n, double * x,
+		double * r)
+{
+	double q[k];
+	double resp[k];
+	for (int i = 0; i < k; i++) {
+		q[i] = 0;
+	}
+
+	for (int m = 1; m <= n; m++) {
+		double tot_resp = 0;
+		for (int i = 0; i < k; i++) {
+			resp[i] = demands[i] * (1 + q[i]);
+			tot_resp += resp[i];
+		}
+
+		double through = m / (think_t + tot_resp);
+		for (int i = 0; i < k; i++) {
+			q[i] = through * resp[i];
+		}
+
+		*(x + m - 1) = through;
+		*(r + m - 1) = tot_resp;
+	}
+}
+
+/* Prints analytic results to stats file in the same shape as record_stats */
+void record_analytic(struct analytic * a, FILE * stats_file)
+{
+	if (a->population > 0) {
+		record_closed(a, stats_file);
+		return;
+	}
+
+	fprintf(stats_file, "ANALYTIC (open Jackson network of M/M/c queues, solved in %.3lf us)\n",
+			a->solve_us);
+	fprintf(stats_file, "\n");
+
+	for (int i = 0; i < ANALYTIC_STATIONS; i++) {
+		struct analytic_station * st = &a->st[i];
+		if (st->saturated) {
+			fprintf(stats_file, "%s is saturated\n", st->name);
+		}
+		fprintf(stats_file, "%s avg queue size = %lf\n", st->name,
+				st->avg_len);
+		fprintf(stats_file, "%s utilization = %lf%%\n", st->name,
+				st->util * 100);
+		fprintf(stats_file, "%s avg response time = %lf\n", st->name,
+				st->resp_t);
+		fprintf(stats_file, "%s throughput = %lf per 100 units of time\n",
+				st->name, st->arrive_rate * 100);
+		fprintf(stats_file, "\n");
+	}
+
+	fprintf(stats_file, "Job avg time in system = %lf\n", a->sojourn_t);
+
+	if (a->mva_pop > 0) {
+		fprintf(stats_file, "\n");
+		fprintf(stats_file, "MVA (closed network, no think time");
+		record_delay(a, stats_file);
+		for (int m = 1; m <= a->mva_pop; m++) {
+			fprintf(stats_file, "N = %d: throughput = %lf per 100 units of time, response time = %lf\n",
+					m, *(a->mva_x + m - 1) * 100,
+					*(a->mva_r + m - 1));
+		}
+	}
+}
+
+/* Prints the results of a closed system to stats file. The open network does
+ * not apply, so only the MVA results are printed, with those for the system's
+ * own population marked */
+static void record_closed(struct analytic * a, FILE * stats_file)
+{
+	fprintf(stats_file, "ANALYTIC (closed network solved by MVA, solved in %.3lf us)\n",
+			a->solve_us);
+	fprintf(stats_file, "\n");
+
+	fprintf(stats_file, "MVA (closed network, think time %lf", a->think_t);
+	record_delay(a, stats_file);
+	for (int m = 1; m <= a->mva_pop; m++) {
+		fprintf(stats_file, "N = %d: throughput = %lf per 100 units of time, response time = %lf%s\n",
+				m, *(a->mva_x + m - 1) * 100,
+				*(a->mva_r + m - 1),
+				m == a->population ? " (POPULATION)" : "");
+	}
+}
+
+/* Ends the heading of the MVA results, naming the delay the extra servers of
+ * each station were solved as, if there are any */
+static void record_delay(struct analytic * a, FILE * stats_file)
+{
+	if (a->delay > 0) {
+		fprintf(stats_file, ", extra servers as a delay of %lf", a->delay);
+	}
+	fprintf(stats_file, ")\n");
+}
@@ -0,0 +1,42 @@
+#ifndef ANALYTIC_H
+#define ANALYTIC_H
+
+#define ANALYTIC_STATIONS 3
+
+/* Analytic results for one station (cpu, disk1 or disk2) */
+struct analytic_station
+{
+	const char * name;
+	int servers;		// Number of identical servers
+	double visits;		// Mean visits per job
+	double service_t;	// Mean service time per visit
+	double arrive_rate;	// Arrivals per unit of time
+	double util;		// Fraction of time busy
+	double avg_len;		// Mean number of jobs at the station
+	double resp_t;		// Mean response time per visit
+	bool saturated;		// Arrival rate is at or beyond service rate
+};
+
+/* Analytic results for the whole cpu/disk network */
+struct analytic
+{
+	struct analytic_station st[ANALYTIC_STATIONS];
+	double arrive_rate;	// Rate jobs enter the system
+	double sojourn_t;	// Mean time from arrival to quitting
+	double solve_us;	// Microseconds spent solving
+	int population;		// Jobs in a closed system, 0 for an open one
+	double think_t;		// Mean think time of a closed system
+	double delay;		// Demand beyond one server per station, solved
+				// by MVA as a delay
+	int mva_pop;		// Number of populations solved by MVA
+	double * mva_x;		// Throughput for populations 1 to mva_pop
+	double * mva_r;		// Response time for populations 1 to mva_pop
+};
+
+struct analytic * init_analytic(struct config * conf);
+void kill_analytic(struct analytic * a);
+void solve_mva(double * demands, int k, double think_t, int n, double * x,
+		double * r);
+void record_analytic(struct analytic * a, FILE * stats_file);
+
+#endif /* not defined ANALYTIC_H */
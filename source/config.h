@@ -0,0 +1,80 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+/* Values for the ANALYTIC config option */
+#define ANALYTIC_OFF 0		// Only simulate
+#define ANALYTIC_ON 1		// Simulate and print analytic results alongside
+#define ANALYTIC_ONLY 2		// Only print analytic results
+
+/* Largest number of job classes, one bit each in a station's occupancy mask */
+#define MAX_CLASSES 32
+
+/* Parameters IPA finds the derivatives of the mean time in system for. They
+ * index every vector of derivatives */
+#define IPA_ARRIVE_MIN 0
+#define IPA_ARRIVE_MAX 1
+#define IPA_CPU_MIN 2
+#define IPA_CPU_MAX 3
+#define IPA_DISK1_MIN 4
+#define IPA_DISK1_MAX 5
+#define IPA_DISK2_MIN 6
+#define IPA_DISK2_MAX 7
+#define IPA_PARAMS 8
+
+/* Structure to hold the arrival and service values of one job class. Values
+ * the config file leaves out are copied from the values for all jobs. */
+struct class_config
+{
+	int arrive_min;
+	int arrive_max;
+	double quit_prob;
+	int cpu_min;
+	int cpu_max;
+	int disk1_min;
+	int disk1_max;
+	int disk2_min;
+	int disk2_max;
+};
+
+/* Structure to hold config values. */
+struct config
+{
+	int seed;
+	int init_time;
+	int fin_time;
+	int arrive_min;
+	int arrive_max;
+	double quit_prob;
+	int cpu_min;
+	int cpu_max;
+	int disk1_min;
+	int disk1_max;
+	int disk2_min;
+	int disk2_max;
+	int cpu_servers;	// Number of identical cpus
+	int disk1_servers;	// Number of identical disk1 servers
+	int disk2_servers;	// Number of identical disk2 servers
+	char trace_file[256];	// Arrival trace to replay, empty if none
+	int analytic;		// One of ANALYTIC_OFF, ANALYTIC_ON, ANALYTIC_ONLY
+	int mva_pop;		// Largest population solved by MVA, 0 for none
+	bool profile_handlers;	// Time every event handler if true
+	int sample_interval;	// Time between logged samples, 0 for none
+	char metrics_shm[256];	// Shared memory for live metrics, empty if none
+	int classes;		// Number of job classes, class 0 served first
+	bool preempt;		// Higher classes preempt lower ones if true
+	struct class_config cls[MAX_CLASSES];
+	long event_mem_limit;	// Far events held in memory, 0 for no limit
+	int replications;	// Replications run in lockstep, 0 for none
+	bool simd;		// Step replications with vector instructions
+	int branch_time;	// Time the simulation branches at
+	char ** branches;	// OPTION=VALUE,... overrides of each branch
+	int num_branches;	// Number of branches, 0 for none
+	bool ipa;		// Estimate derivatives by IPA if true
+	bool fast_sched;	// Keep events in a tournament when the model fits
+	int population;		// Jobs in a closed system, 0 for an open one
+	int think_min;		// Think time between a closed system's jobs
+	int think_max;
+	bool pop_sweep;		// Simulate every population up to POPULATION
+};
+
+#endif /* not defined CONFIG_H */
@@ -0,0 +1,447 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "min_heap.h"
+#include "event_set.h"
+
+/* Template of the spill file, created in the working directory, next to the
+ * log and stats files, and unlinked as soon as it is open */
+#define SPILL_TEMPLATE "events.XXXXXX"
+
+static void spill_buf(struct event_set * es);
+static void open_spill(struct event_set * es);
+static void write_events(struct event_set * es, const struct event * events,
+		long count, off_t off);
+static void add_run(struct event_set * es, off_t off, long count);
+static void refill(struct event_set * es);
+static void renumber(struct event_set * es);
+static int merge_start(struct event_set * es, int * heap);
+static void drop_run(struct event_set * es, int i);
+static const struct event * merge_head(struct event_set * es, int src, long b);
+static void merge_sift(struct event_set * es, int * heap, int n, int i, long b);
+static int cmp_key(const void * a, const void * b);
+
+/* Function to create an event set. limit is how many far future events may be
+ * held in memory before they are spilled to disk, or 0 to keep every event in
+ * memory.
+ */
+struct event_set * init_event_set(long limit)
+{
+	struct event_set * es = malloc(sizeof(struct event_set));
+	es->near = init_heap();
+	es->seq = 0;
+	init_key_watch(&es->watch);
+	es->buf = NULL;
+	es->buf_size = 0;
+	es->limit = limit;
+	es->batch = limit / 4 > 0 ? limit / 4 : 1;
+	es->runs = NULL;
+	es->num_runs = 0;
+	es->runs_capacity = 0;
+	es->fd = -1;
+	es->file_len = 0;
+	es->spilled_runs = 0;
+	es->spilled = 0;
+	es->refills = 0;
+
+	/* Without a limit the horizon is past every key */
+	if (limit > 0) {
+		es->horizon = 0;
+		es->buf = malloc(sizeof(struct event) * limit);
+	} else {
+		es->horizon = EVENT_KEY_MAX;
+	}
+
+	return es;
+}
+
+/* Function to free an event set, along with the events still in it */
+void kill_event_set(struct event_set * es)
+{
+	kill_heap(es->near);
+	while (es->num_runs > 0) {
+		drop_run(es, es->num_runs - 1);
+	}
+	free(es->runs);
+	free(es->buf);
+	kill_key_watch(&es->watch);
+	if (es->fd != -1) {
+		close(es->fd);
+	}
+	free(es);
+}
+
+/* Stamps event with its key and adds it to the set, taking ownership of it.
+ * Returns the key, as a far event is copied and freed here.
+ */
+event_key_t event_set_push(struct event_set * es, struct event * e)
+{
+	if (es->seq == EVENT_SEQ_LIMIT) {
+		renumber(es);
+	}
+	e->key = event_key(e->time, es->seq++);
+	event_key_t key = e->key;
+
+	if (key < es->horizon) {
+		heap_push_keyed(es->near, e);
+		return key;
+	}
+
+	if (es->buf_size >= es->limit) {
+		spill_buf(es);
+	}
+	*(es->buf + es->buf_size) = *e;
+	es->buf_size++;
+	free(e);
+
+	return key;
+}
+
+/* Pops the event with the smallest key, refilling the near heap first if it has
+ * run dry. Returns NULL if the set is empty.
+ */
+struct event * event_set_pop(struct event_set * es)
+{
+	if (heap_is_empty(es->near)) {
+		refill(es);
+		if (heap_is_empty(es->near)) {
+			return NULL;
+		}
+	}
+	return heap_pop(es->near);
+}
+
+bool event_set_is_empty(struct event_set * es)
+{
+	return heap_is_empty(es->near) && es->buf_size == 0
+			&& es->num_runs == 0;
+}
+
+/* Sorts the buffer and writes it to the end of the spill file as a new run,
+ * which is mapped back in to be read when its events come up.
+ */
+static void spill_buf(struct event_set * es)
+{
+	open_spill(es);
+	qsort(es->buf, es->buf_size, sizeof(struct event), cmp_key);
+	write_events(es, es->buf, es->buf_size, es->file_len);
+	add_run(es, es->file_len, es->buf_size);
+
+	es->spilled_runs++;
+	es->spilled += es->buf_size;
+	es->buf_size = 0;
+}
+
+/* Creates the spill file if there is none yet */
+static void open_spill(struct event_set * es)
+{
+	if (es->fd != -1) {
+		return;
+	}
+	char path[] = SPILL_TEMPLATE;
+	es->fd = mkstemp(path);
+	if (es->fd < 0) {
+		fprintf(stderr, "Error: Could not create event spill file\n");
+		exit(1);
+	}
+	unlink(path);
+}
+
+/* Writes count events to the spill file at off */
+static void write_events(struct event_set * es, const struct event * events,
+		long count, off_t off)
+{
+	size_t len = sizeof(struct event) * count;
+	const char * p = (const char *) events;
+	size_t done = 0;
+	while (done < len) {
+		ssize_t n = pwrite(es->fd, p + done, len - done, off + done);
+		if (n <= 0) {
+			fprintf(stderr, "Error: Could not write event spill file\n");
+			exit(1);
+		}
+		done += n;
+	}
+}
+
+/* Maps the count sorted events written at off, the end of the spill file, and
+ * adds them as a new run. Runs start on a page boundary so each can be mapped
+ * on its own.
+ */
+static void add_run(struct event_set * es, off_t off, long count)
+{
+	size_t len = sizeof(struct event) * count;
+	long page = sysconf(_SC_PAGESIZE);
+	size_t map_len = (len + page - 1) / page * page;
+	es->file_len = off + map_len;
+
+	void * map = mmap(NULL, map_len, PROT_READ, MAP_PRIVATE, es->fd, off);
+	if (map == MAP_FAILED) {
+		fprintf(stderr, "Error: Could not map event spill file\n");
+		exit(1);
+	}
+	madvise(map, map_len, MADV_SEQUENTIAL);
+
+	if (es->num_runs >= es->runs_capacity) {
+		es->runs_capacity = es->runs_capacity > 0
+				? es->runs_capacity * 2 : 4;
+		es->runs = realloc(es->runs, sizeof(struct event_run)
+				* es->runs_capacity);
+	}
+	struct event_run * run = es->runs + es->num_runs;
+	run->recs = map;
+	run->map = map;
+	run->map_len = map_len;
+	run->off = off;
+	run->count = count;
+	run->next = 0;
+	run->shared = false;
+	es->num_runs++;
+}
+
+/* Moves the next batch of far events into the near heap by merging the sorted
+ * buffer with the heads of the runs, then moves the horizon up to just past the
+ * last one moved. Every event left behind has a larger key, so events still
+ * come out of the set in key order. The sources being merged are kept in a
+ * small heap by the key of their head, so each event moved costs log of the
+ * number of runs rather than a look at every run.
+ */
+static void refill(struct event_set * es)
+{
+	if (es->buf_size == 0 && es->num_runs == 0) {
+		return;
+	}
+	es->refills++;
+
+	qsort(es->buf, es->buf_size, sizeof(struct event), cmp_key);
+
+	long b = 0;	// Next unmoved event in buf
+	int * heap = malloc(sizeof(int) * (es->num_runs + 1));
+	int n = merge_start(es, heap);
+
+	event_key_t last = 0;
+	for (long moved = 0; moved < es->batch && n > 0; moved++) {
+		int src = *heap;
+		struct event * e = malloc(sizeof(struct event));
+		*e = *merge_head(es, src, b);
+		heap_push_keyed(es->near, e);
+		last = e->key;
+
+		if (src == es->num_runs) {
+			b++;
+		} else {
+			(es->runs + src)->next++;
+		}
+		if (merge_head(es, src, b) == NULL) {
+			n--;
+			*heap = *(heap + n);
+		}
+		merge_sift(es, heap, n, 0, b);
+	}
+	free(heap);
+
+	/* Closes the gap left in buf and drops runs that have been read */
+	memmove(es->buf, es->buf + b, sizeof(struct event) * (es->buf_size - b));
+	es->buf_size -= b;
+	for (int i = es->num_runs - 1; i >= 0; i--) {
+		if ((es->runs + i)->next >= (es->runs + i)->count) {
+			drop_run(es, i);
+		}
+	}
+
+	es->horizon = last + 1;
+}
+
+/* Gives every pending event a new sequence number counting up from 0 in key
+ * order, keeping its time, once the sequence numbers have run out. Every near
+ * event is before every far one, so the near heap is renumbered first, then the
+ * buffer and the runs are merged into a single new run, renumbered as they are
+ * written. The order of the events is unchanged, and keys in the watch follow
+ * their events.
+ */
+static void renumber(struct event_set * es)
+{
+	remap_begin(&es->watch);
+	es->seq = heap_renumber(es->near, 0, &es->watch);
+	if (es->limit == 0) {
+		remap_end(&es->watch);
+		return;
+	}
+
+	/* With no far events the horizon goes just past the last near one,
+	 * and otherwise to the first far one */
+	es->horizon = 0;
+	if (!heap_is_empty(es->near)) {
+		es->horizon = (*(es->near->arr + es->near->size - 1))->key + 1;
+	}
+	if (es->buf_size == 0 && es->num_runs == 0) {
+		remap_end(&es->watch);
+		return;
+	}
+
+	open_spill(es);
+	qsort(es->buf, es->buf_size, sizeof(struct event), cmp_key);
+
+	long b = 0;	// Next unwritten event in buf
+	int * heap = malloc(sizeof(int) * (es->num_runs + 1));
+	int n = merge_start(es, heap);
+	struct event * out = malloc(sizeof(struct event) * es->batch);
+	long out_size = 0;
+	long count = 0;
+	off_t off = es->file_len;
+	while (n > 0) {
+		int src = *heap;
+		struct event * e = out + out_size;
+		*e = *merge_head(es, src, b);
+		event_key_t key = event_key(e->time, es->seq++);
+		remap_key(&es->watch, e->key, key);
+		e->key = key;
+		if (count == 0) {
+			es->horizon = key;
+		}
+		out_size++;
+		count++;
+		if (out_size == es->batch) {
+			write_events(es, out, out_size, off + sizeof(struct event)
+					* (count - out_size));
+			out_size = 0;
+		}
+
+		if (src == es->num_runs) {
+			b++;
+		} else {
+			(es->runs + src)->next++;
+		}
+		if (merge_head(es, src, b) == NULL) {
+			n--;
+			*heap = *(heap + n);
+		}
+		merge_sift(es, heap, n, 0, b);
+	}
+	write_events(es, out, out_size, off + sizeof(struct event)
+			* (count - out_size));
+	free(out);
+	free(heap);
+	remap_end(&es->watch);
+
+	/* The new run takes the place of the buffer and the old runs */
+	es->buf_size = 0;
+	while (es->num_runs > 0) {
+		drop_run(es, es->num_runs - 1);
+	}
+	add_run(es, off, count);
+}
+
+/* Fills heap with the merge sources that have events left, source i being run i
+ * and source num_runs the sorted buffer, ordered by the key of their heads, and
+ * returns how many there are */
+static int merge_start(struct event_set * es, int * heap)
+{
+	int n = 0;
+	for (int src = 0; src <= es->num_runs; src++) {
+		if (merge_head(es, src, 0) != NULL) {
+			*(heap + n) = src;
+			n++;
+		}
+	}
+	for (int i = n / 2 - 1; i >= 0; i--) {
+		merge_sift(es, heap, n, i, 0);
+	}
+	return n;
+}
+
+/* Returns the next unmoved event of merge source src, which is run src or, for
+ * src equal to num_runs, the buffer from index b on. NULL if none are left. */
+static const struct event * merge_head(struct event_set * es, int src, long b)
+{
+	if (src == es->num_runs) {
+		return b < es->buf_size ? es->buf + b : NULL;
+	}
+	struct event_run * run = es->runs + src;
+	return run->next < run->count ? run->recs + run->next : NULL;
+}
+
+/* Moves the source at index i of the merge heap of n sources down until the key
+ * of its head is no larger than those of its children */
+static void merge_sift(struct event_set * es, int * heap, int n, int i, long b)
+{
+	while (true) {
+		int l = 2 * i + 1;
+		int r = l + 1;
+		int min = i;
+		if (l < n && merge_head(es, *(heap + l), b)->key
+				< merge_head(es, *(heap + min), b)->key) {
+			min = l;
+		}
+		if (r < n && merge_head(es, *(heap + r), b)->key
+				< merge_head(es, *(heap + min), b)->key) {
+			min = r;
+		}
+		if (min == i) {
+			return;
+		}
+		int tmp = *(heap + i);
+		*(heap + i) = *(heap + min);
+		*(heap + min) = tmp;
+		i = min;
+	}
+}
+
+/* Unmaps run i, gives its space in the spill file back to the file system
+ * unless another process still reads it, and removes it from the list of runs */
+static void drop_run(struct event_set * es, int i)
+{
+	struct event_run * run = es->runs + i;
+	munmap(run->map, run->map_len);
+	if (!run->shared) {
+		fallocate(es->fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+				run->off, run->map_len);
+	}
+
+	*run = *(es->runs + es->num_runs - 1);
+	es->num_runs--;
+}
+
+/* Readies an event set for use after a fork. The runs spilled so far are
+ * shared with the other process, which reads them through its own mappings, so
+ * they are marked to be left in the spill file when dropped. Later runs go to a
+ * new spill file of this process's own, as the two would otherwise write over
+ * each other at the same offsets.
+ */
+void event_set_fork(struct event_set * es)
+{
+	for (int i = 0; i < es->num_runs; i++) {
+		(es->runs + i)->shared = true;
+	}
+	if (es->fd != -1) {
+		close(es->fd);
+		es->fd = -1;
+	}
+	es->file_len = 0;
+}
+
+/* Orders events by key for qsort */
+static int cmp_key(const void * a, const void * b)
+{
+	event_key_t ka = ((const struct event *) a)->key;
+	event_key_t kb = ((const struct event *) b)->key;
+	return (ka > kb) - (ka < kb);
+}
+
+/* Prints how much the event set spilled to disk to stats file */
+void record_event_set_stats(struct event_set * es, FILE * stats_file)
+{
+	if (es->limit == 0) {
+		return;
+	}
+	fprintf(stats_file, "\n");
+	fprintf(stats_file, "Event runs spilled to disk = %lld\n",
+			es->spilled_runs);
+	fprintf(stats_file, "Events spilled to disk = %lld\n", es->spilled);
+	fprintf(stats_file, "Event set refills = %lld\n", es->refills);
+}
@@ -0,0 +1,57 @@
+#ifndef EVENT_SET_H
+#define EVENT_SET_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+/* A sorted run of far future events spilled to the spill file and mapped back
+ * in for reading. Its events are read front to back as time catches up.
+ */
+struct event_run
+{
+	const struct event * recs;	// Events of the run, sorted by key
+	void * map;			// Mapping of the run
+	size_t map_len;			// Length of the mapping
+	off_t off;			// Offset of the run in the spill file
+	long count;			// Number of events in the run
+	long next;			// Index of the next event to read
+	bool shared;			// Also read by a forked process
+};
+
+/* The pending events of a simulation. Events before horizon are kept in a heap
+ * in memory. Events at or after it go into an unsorted buffer, and a full
+ * buffer is sorted and spilled to disk as a run, so memory stays bounded no
+ * matter how many events are pending. When the heap runs dry the next batch of
+ * events is merged out of the buffer and runs into it and the horizon moves up
+ * past them. With no memory limit every event goes straight into the heap.
+ */
+struct event_set
+{
+	struct min_heap * near;		// Events before horizon
+	event_key_t horizon;		// Key every far event is at or after
+	uint32_t seq;			// Sequence number of the next push
+	struct key_watch watch;		// Keys held by the caller, kept when renumbered
+	struct event * buf;		// Far events not yet spilled, unsorted
+	long buf_size;			// Number of events in buf
+	long limit;			// Capacity of buf, 0 if unlimited
+	long batch;			// Events moved into near per refill
+	struct event_run * runs;	// Runs still holding unread events
+	int num_runs;
+	int runs_capacity;
+	int fd;				// Spill file, -1 until first spill
+	off_t file_len;			// End of the spill file
+
+	long long spilled_runs;		// Number of runs written
+	long long spilled;		// Number of events written to runs
+	long long refills;		// Number of times near was refilled
+};
+
+struct event_set * init_event_set(long limit);
+void kill_event_set(struct event_set * es);
+event_key_t event_set_push(struct event_set * es, struct event * e);
+struct event * event_set_pop(struct event_set * es);
+bool event_set_is_empty(struct event_set * es);
+void event_set_fork(struct event_set * es);
+void record_event_set_stats(struct event_set * es, FILE * stats_file);
+
+#endif /* not defined EVENT_SET_H */
@@ -0,0 +1,301 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include "config.h"
+#include "job_table.h"
+
+#define INIT_CAPACITY 64
+
+static void init_job_stats(struct job_stats * js);
+static void record_job(struct job_table * jt, int slot, int t);
+static void add_job_stats(struct job_stats * js, int sojourn, int visits,
+		int service_t);
+static void record_class_stats(struct job_stats * js, const char * prefix,
+		FILE * stats_file);
+static int hist_bin(int x);
+static int hist_bin_floor(int bin);
+
+/* Function to create and initialize a new job table for jobs of the given
+ * number of classes. Jobs also carry the derivatives of their times if ipa is
+ * true.
+ */
+struct job_table * init_job_table(int classes, bool ipa)
+{
+	struct job_table * jt = malloc(sizeof(struct job_table));
+	jt->id = malloc(sizeof(long long) * INIT_CAPACITY);
+	jt->cls = malloc(sizeof(int) * INIT_CAPACITY);
+	jt->arrive_t = malloc(sizeof(int) * INIT_CAPACITY);
+	jt->visits = malloc(sizeof(int) * INIT_CAPACITY);
+	jt->service_t = malloc(sizeof(int) * INIT_CAPACITY);
+	jt->server = malloc(sizeof(int) * INIT_CAPACITY);
+	jt->next_free = malloc(sizeof(int) * INIT_CAPACITY);
+	jt->d_arrive_t = NULL;
+	jt->d_t = NULL;
+	if (ipa) {
+		jt->d_arrive_t = malloc(sizeof(double) * INIT_CAPACITY
+				* IPA_PARAMS);
+		jt->d_t = malloc(sizeof(double) * INIT_CAPACITY * IPA_PARAMS);
+	}
+	jt->free_head = -1;
+	jt->size = 0;
+	jt->capacity = INIT_CAPACITY;
+	jt->classes = classes;
+
+	init_job_stats(&jt->all);
+	jt->by_cls = malloc(sizeof(struct job_stats) * classes);
+	for (int k = 0; k < classes; k++) {
+		init_job_stats(jt->by_cls + k);
+	}
+
+	return jt;
+}
+
+/* Function used to zero the statistics of a set of jobs */
+static void init_job_stats(struct job_stats * js)
+{
+	js->done_jobs = 0;
+	js->tot_sojourn_t = 0;
+	js->tot_visits = 0;
+	js->tot_service_t = 0;
+	js->max_sojourn_t = 0;
+	for (int p = 0; p < IPA_PARAMS; p++) {
+		js->d_sojourn_t[p] = 0;
+	}
+	for (int i = 0; i < JOB_HIST_BINS; i++) {
+		js->hist[i] = 0;
+	}
+}
+
+/* Starts the statistics of all jobs and of each class over. Jobs still in the
+ * system are counted when they leave. */
+void job_table_reset_stats(struct job_table * jt)
+{
+	init_job_stats(&jt->all);
+	for (int k = 0; k < jt->classes; k++) {
+		init_job_stats(jt->by_cls + k);
+	}
+}
+
+/* Drops every job in the system and starts the statistics over. The slots
+ * allocated so far are kept for the jobs that come next. */
+void job_table_clear(struct job_table * jt)
+{
+	jt->free_head = -1;
+	jt->size = 0;
+	job_table_reset_stats(jt);
+}
+
+/* Function to free a job table */
+void kill_job_table(struct job_table * jt)
+{
+	free(jt->id);
+	free(jt->cls);
+	free(jt->arrive_t);
+	free(jt->visits);
+	free(jt->service_t);
+	free(jt->server);
+	free(jt->next_free);
+	free(jt->d_arrive_t);
+	free(jt->d_t);
+	free(jt->by_cls);
+	free(jt);
+}
+
+/* Function used to grow every field array when all slots are in use */
+static void grow_table(struct job_table * jt)
+{
+	int new_capacity = jt->capacity * 2;
+	jt->id = realloc(jt->id, sizeof(long long) * new_capacity);
+	jt->cls = realloc(jt->cls, sizeof(int) * new_capacity);
+	jt->arrive_t = realloc(jt->arrive_t, sizeof(int) * new_capacity);
+	jt->visits = realloc(jt->visits, sizeof(int) * new_capacity);
+	jt->service_t = realloc(jt->service_t, sizeof(int) * new_capacity);
+	jt->server = realloc(jt->server, sizeof(int) * new_capacity);
+	jt->next_free = realloc(jt->next_free, sizeof(int) * new_capacity);
+	if (jt->d_t != NULL) {
+		jt->d_arrive_t = realloc(jt->d_arrive_t, sizeof(double)
+				* new_capacity * IPA_PARAMS);
+		jt->d_t = realloc(jt->d_t, sizeof(double) * new_capacity
+				* IPA_PARAMS);
+	}
+	jt->capacity = new_capacity;
+}
+
+/* Takes a slot for a job of class cls entering the system at time t and returns
+ * it. Freed slots are reused first, so the table only grows when the number of
+ * jobs in the system reaches a new high.
+ */
+int job_alloc(struct job_table * jt, long long id, int cls, int t)
+{
+	int slot;
+	if (jt->free_head != -1) {
+		slot = jt->free_head;
+		jt->free_head = *(jt->next_free + slot);
+	} else {
+		if (jt->size >= jt->capacity) {
+			grow_table(jt);
+		}
+		slot = jt->size;
+		jt->size++;
+	}
+
+	*(jt->id + slot) = id;
+	*(jt->cls + slot) = cls;
+	*(jt->arrive_t + slot) = t;
+	*(jt->visits + slot) = 0;
+	*(jt->service_t + slot) = 0;
+	*(jt->server + slot) = -1;
+	if (jt->d_t != NULL) {
+		for (int p = 0; p < IPA_PARAMS; p++) {
+			*(jt->d_arrive_t + slot * IPA_PARAMS + p) = 0;
+			*(jt->d_t + slot * IPA_PARAMS + p) = 0;
+		}
+	}
+
+	return slot;
+}
+
+/* Records the end to end statistics of a job quitting at time t and puts its
+ * slot on the free list */
+void job_release(struct job_table * jt, int slot, int t)
+{
+	record_job(jt, slot, t);
+
+	*(jt->next_free + slot) = jt->free_head;
+	jt->free_head = slot;
+}
+
+/* Records the end to end statistics of a job of a closed system leaving at time
+ * t, and keeps its slot for when it comes back at time next_t. The job keeps
+ * its number and class.
+ */
+void job_recycle(struct job_table * jt, int slot, int t, int next_t)
+{
+	record_job(jt, slot, t);
+
+	*(jt->arrive_t + slot) = next_t;
+	*(jt->visits + slot) = 0;
+	*(jt->service_t + slot) = 0;
+	*(jt->server + slot) = -1;
+}
+
+/* Adds the end to end statistics of a job leaving at time t to those of all
+ * jobs and of its class. With IPA on, the derivatives of t must be in the job's
+ * d_t.
+ */
+static void record_job(struct job_table * jt, int slot, int t)
+{
+	int sojourn = t - *(jt->arrive_t + slot);
+	int visits = *(jt->visits + slot);
+	int service_t = *(jt->service_t + slot);
+	struct job_stats * by_cls = jt->by_cls + *(jt->cls + slot);
+
+	add_job_stats(&jt->all, sojourn, visits, service_t);
+	add_job_stats(by_cls, sojourn, visits, service_t);
+
+	if (jt->d_t != NULL) {
+		for (int p = 0; p < IPA_PARAMS; p++) {
+			double d = *(jt->d_t + slot * IPA_PARAMS + p)
+					- *(jt->d_arrive_t + slot * IPA_PARAMS + p);
+			jt->all.d_sojourn_t[p] += d;
+			by_cls->d_sojourn_t[p] += d;
+		}
+	}
+}
+
+/* Function used to add a quit job to a set of statistics */
+static void add_job_stats(struct job_stats * js, int sojourn, int visits,
+		int service_t)
+{
+	js->done_jobs++;
+	js->tot_sojourn_t += sojourn;
+	js->tot_visits += visits;
+	js->tot_service_t += service_t;
+	if (js->max_sojourn_t < sojourn) {
+		js->max_sojourn_t = sojourn;
+	}
+	js->hist[hist_bin(sojourn)]++;
+}
+
+/* Returns the histogram bin holding x. Values below JOB_HIST_SUB get a bin each,
+ * larger values share a bin with values of the same power of two and the same
+ * leading bits.
+ */
+static int hist_bin(int x)
+{
+	if (x < JOB_HIST_SUB) {
+		return x < 0 ? 0 : x;
+	}
+
+	int log = 31 - __builtin_clz(x);
+	int shift = log - __builtin_ctz(JOB_HIST_SUB);
+	return (shift + 1) * JOB_HIST_SUB + ((x >> shift) - JOB_HIST_SUB);
+}
+
+/* Returns the smallest value that falls in bin */
+static int hist_bin_floor(int bin)
+{
+	if (bin < JOB_HIST_SUB) {
+		return bin;
+	}
+
+	int shift = bin / JOB_HIST_SUB - 1;
+	return (JOB_HIST_SUB + bin % JOB_HIST_SUB) << shift;
+}
+
+/* Returns the time in system that fraction p of quit jobs stayed within */
+int job_percentile(struct job_stats * js, double p)
+{
+	long long rank = (long long) (p * js->done_jobs);
+	long long seen = 0;
+
+	for (int i = 0; i < JOB_HIST_BINS; i++) {
+		seen += js->hist[i];
+		if (seen > rank) {
+			return hist_bin_floor(i);
+		}
+	}
+	return js->max_sojourn_t;
+}
+
+/* Prints end to end statistics to stats file, followed by those of each class
+ * when there is more than one */
+void record_job_stats(struct job_table * jt, FILE * stats_file)
+{
+	record_class_stats(&jt->all, "Job", stats_file);
+	if (jt->classes == 1) {
+		return;
+	}
+
+	char prefix[32];
+	for (int k = 0; k < jt->classes; k++) {
+		snprintf(prefix, sizeof(prefix), "Class %d job", k);
+		fprintf(stats_file, "\n");
+		record_class_stats(jt->by_cls + k, prefix, stats_file);
+	}
+}
+
+/* Prints one set of end to end statistics to stats file, with each line
+ * starting with prefix */
+static void record_class_stats(struct job_stats * js, const char * prefix,
+		FILE * stats_file)
+{
+	fprintf(stats_file, "%ss completed = %lld\n", prefix, js->done_jobs);
+	fprintf(stats_file, "%s avg time in system = %lf\n", prefix,
+			js->tot_sojourn_t / (double) js->done_jobs);
+	fprintf(stats_file, "%s max time in system = %d\n", prefix,
+			js->max_sojourn_t);
+	fprintf(stats_file, "%s p50 time in system = %d\n", prefix,
+			job_percentile(js, .50));
+	fprintf(stats_file, "%s p95 time in system = %d\n", prefix,
+			job_percentile(js, .95));
+	fprintf(stats_file, "%s p99 time in system = %d\n", prefix,
+			job_percentile(js, .99));
+	fprintf(stats_file, "%s avg visits = %lf\n", prefix,
+			js->tot_visits / (double) js->done_jobs);
+	fprintf(stats_file, "%s avg service time = %lf\n", prefix,
+			js->tot_service_t / (double) js->done_jobs);
+	fprintf(stats_file, "%s avg waiting time = %lf\n", prefix,
+			(js->tot_sojourn_t - js->tot_service_t)
+			/ (double) js->done_jobs);
+}
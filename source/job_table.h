@@ -0,0 +1,58 @@
+#ifndef JOB_TABLE_H
+#define JOB_TABLE_H
+
+/* Sojourn times are binned by power of two, and each power of two is split into
+ * JOB_HIST_SUB equal sub bins, so percentiles are exact to within 1/JOB_HIST_SUB
+ * of their magnitude.
+ */
+#define JOB_HIST_SUB 16
+#define JOB_HIST_BINS (32 * JOB_HIST_SUB)
+
+/* End to end statistics of jobs that have quit */
+struct job_stats
+{
+	long long done_jobs;		// Number of jobs that quit
+	long long tot_sojourn_t;	// Sum of times in system
+	long long tot_visits;		// Sum of server visits
+	long long tot_service_t;	// Sum of service times
+	int max_sojourn_t;		// Largest time in system
+	double d_sojourn_t[IPA_PARAMS];	// Sum of derivatives of times in system
+	long long hist[JOB_HIST_BINS];	// Distribution of times in system
+};
+
+/* Table of the jobs currently in the system, indexed by slot. Each field is its
+ * own array so that walking one field touches only that field's memory. Slots
+ * of jobs that quit are put on a free list and reused by later jobs.
+ */
+struct job_table
+{
+	long long * id;		// Job number shown in the log
+	int * cls;		// Class of the job, 0 is served first
+	int * arrive_t;		// Time the job entered the system
+	int * visits;		// Number of server visits completed
+	int * service_t;	// Total time spent being served
+	int * server;		// Server the job is at, -1 if waiting
+	int * next_free;	// Next slot on the free list, -1 at end
+	double * d_arrive_t;	// Derivatives of arrive_t, IPA_PARAMS per slot,
+				// NULL without IPA
+	double * d_t;		// Derivatives of the time the job got to its
+				// current station, NULL without IPA
+	int free_head;		// First slot on the free list, -1 if none
+	int size;		// Number of slots in use
+	int capacity;		// Number of slots allocated
+	int classes;		// Number of job classes
+	struct job_stats all;	// Statistics of every job
+	struct job_stats * by_cls; // Statistics of each class of job
+};
+
+struct job_table * init_job_table(int classes, bool ipa);
+void kill_job_table(struct job_table * jt);
+int job_alloc(struct job_table * jt, long long id, int cls, int t);
+void job_release(struct job_table * jt, int slot, int t);
+void job_recycle(struct job_table * jt, int slot, int t, int next_t);
+int job_percentile(struct job_stats * js, double p);
+void record_job_stats(struct job_table * jt, FILE * stats_file);
+void job_table_reset_stats(struct job_table * jt);
+void job_table_clear(struct job_table * jt);
+
+#endif /* not defined JOB_TABLE_H */
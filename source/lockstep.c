@@ -0,0 +1,549 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <limits.h>
+#include <math.h>
+#include <time.h>
+#include "config.h"
+#include "lockstep.h"
+
+/* Finish time of a station with no job */
+#define LOCKSTEP_IDLE INT_MAX
+
+/* Multiplier and increment of each lane's LCG */
+#define LCG_A 1664525u
+#define LCG_C 1013904223u
+
+static const char * isa_names[] = { "scalar", "avx2", "avx512" };
+
+/* Values of the model every lane shares, with each uniform given as its
+ * minimum and the width of its range */
+struct lane_params
+{
+	int fin_time;
+	int arrive_min;
+	int arrive_range;
+	int cpu_min;
+	int cpu_range;
+	int d1_min;
+	int d1_range;
+	int d2_min;
+	int d2_range;
+	int quit_prob_i;	// Chance of quitting in thousandths
+};
+
+static int step_scalar(struct lockstep * ls, const struct lane_params * p);
+static int step_avx2(struct lockstep * ls, const struct lane_params * p);
+static int step_avx512(struct lockstep * ls, const struct lane_params * p);
+static void * lane_array(int width, size_t size);
+static void record_metric(const char * name, double * x, int n,
+		FILE * stats_file);
+
+/* Function to create REPLICATIONS lanes of the model described by conf, each
+ * with its own random number generator seeded from SEED, and pick the widest
+ * instruction set the machine supports to step them with.
+ */
+struct lockstep * init_lockstep(struct config * conf)
+{
+	int n = conf->replications;
+	int w = (n + LOCKSTEP_WIDTH - 1) / LOCKSTEP_WIDTH * LOCKSTEP_WIDTH;
+	struct lockstep * ls = malloc(sizeof(struct lockstep));
+	ls->lanes = n;
+	ls->width = w;
+	ls->init_time = conf->init_time;
+	ls->fin_time = conf->fin_time;
+	ls->steps = 0;
+	ls->wall_sec = 0;
+
+	ls->isa = LOCKSTEP_SCALAR;
+	if (conf->simd) {
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx512f")
+				&& __builtin_cpu_supports("avx512vl")
+				&& __builtin_cpu_supports("avx512bw")
+				&& __builtin_cpu_supports("avx512dq")) {
+			ls->isa = LOCKSTEP_AVX512;
+		} else if (__builtin_cpu_supports("avx2")) {
+			ls->isa = LOCKSTEP_AVX2;
+		}
+	}
+
+	ls->t = lane_array(w, sizeof(int));
+	ls->arrive_t = lane_array(w, sizeof(int));
+	ls->cpu_fin_t = lane_array(w, sizeof(int));
+	ls->d1_fin_t = lane_array(w, sizeof(int));
+	ls->d2_fin_t = lane_array(w, sizeof(int));
+	ls->cpu_size = lane_array(w, sizeof(int));
+	ls->d1_size = lane_array(w, sizeof(int));
+	ls->d2_size = lane_array(w, sizeof(int));
+	ls->rng = lane_array(w, sizeof(uint32_t));
+	ls->cpu_max = lane_array(w, sizeof(int));
+	ls->d1_max = lane_array(w, sizeof(int));
+	ls->d2_max = lane_array(w, sizeof(int));
+	ls->cpu_cumul_len = lane_array(w, sizeof(long long));
+	ls->d1_cumul_len = lane_array(w, sizeof(long long));
+	ls->d2_cumul_len = lane_array(w, sizeof(long long));
+	ls->num_lens = lane_array(w, sizeof(long long));
+	ls->cpu_area = lane_array(w, sizeof(long long));
+	ls->d1_area = lane_array(w, sizeof(long long));
+	ls->d2_area = lane_array(w, sizeof(long long));
+	ls->cpu_busy_t = lane_array(w, sizeof(long long));
+	ls->d1_busy_t = lane_array(w, sizeof(long long));
+	ls->d2_busy_t = lane_array(w, sizeof(long long));
+	ls->cpu_comp_jobs = lane_array(w, sizeof(long long));
+	ls->d1_comp_jobs = lane_array(w, sizeof(long long));
+	ls->d2_comp_jobs = lane_array(w, sizeof(long long));
+	ls->quits = lane_array(w, sizeof(long long));
+
+	/* Lanes past the last replication only pad out the last vector, and
+	 * never have an event */
+	for (int i = 0; i < w; i++) {
+		*(ls->t + i) = conf->init_time;
+		*(ls->arrive_t + i) = i < n ? conf->init_time : LOCKSTEP_IDLE;
+		*(ls->cpu_fin_t + i) = LOCKSTEP_IDLE;
+		*(ls->d1_fin_t + i) = LOCKSTEP_IDLE;
+		*(ls->d2_fin_t + i) = LOCKSTEP_IDLE;
+
+		/* Seeds are spread out with a mix of SEED and the lane number,
+		 * so neighbouring lanes do not start on related streams */
+		uint32_t x = (uint32_t) conf->seed + (uint32_t) i * 0x9e3779b9u;
+		x = (x ^ (x >> 16)) * 0x85ebca6bu;
+		x = (x ^ (x >> 13)) * 0xc2b2ae35u;
+		*(ls->rng + i) = x ^ (x >> 16);
+	}
+
+	return ls;
+}
+
+/* Function used to allocate a zeroed array of width lanes, aligned for vectors
+ * of LOCKSTEP_WIDTH lanes */
+static void * lane_array(int width, size_t size)
+{
+	size_t len = (width * size + 63) / 64 * 64;
+	void * retval = aligned_alloc(64, len);
+	memset(retval, 0, len);
+	return retval;
+}
+
+/* Function to free a lockstep run */
+void kill_lockstep(struct lockstep * ls)
+{
+	free(ls->t);
+	free(ls->arrive_t);
+	free(ls->cpu_fin_t);
+	free(ls->d1_fin_t);
+	free(ls->d2_fin_t);
+	free(ls->cpu_size);
+	free(ls->d1_size);
+	free(ls->d2_size);
+	free(ls->rng);
+	free(ls->cpu_max);
+	free(ls->d1_max);
+	free(ls->d2_max);
+	free(ls->cpu_cumul_len);
+	free(ls->d1_cumul_len);
+	free(ls->d2_cumul_len);
+	free(ls->num_lens);
+	free(ls->cpu_area);
+	free(ls->d1_area);
+	free(ls->d2_area);
+	free(ls->cpu_busy_t);
+	free(ls->d1_busy_t);
+	free(ls->d2_busy_t);
+	free(ls->cpu_comp_jobs);
+	free(ls->d1_comp_jobs);
+	free(ls->d2_comp_jobs);
+	free(ls->quits);
+	free(ls);
+}
+
+/* Steps every lane until all of them reach FIN_TIME */
+void run_lockstep(struct lockstep * ls, struct config * conf)
+{
+	struct lane_params p;
+	p.fin_time = conf->fin_time;
+	p.arrive_min = conf->arrive_min;
+	p.arrive_range = conf->arrive_max - conf->arrive_min;
+	p.cpu_min = conf->cpu_min;
+	p.cpu_range = conf->cpu_max - conf->cpu_min;
+	/* Disk1 starts from DISK2_MIN, as it does in calc_job_time */
+	p.d1_min = conf->disk2_min;
+	p.d1_range = conf->disk1_max - conf->disk1_min;
+	p.d2_min = conf->disk2_min;
+	p.d2_range = conf->disk2_max - conf->disk2_min;
+	p.quit_prob_i = (int) round(conf->quit_prob * 1000);
+
+	int (*step)(struct lockstep *, const struct lane_params *);
+	switch (ls->isa) {
+	case LOCKSTEP_AVX512 :
+		step = step_avx512;
+		break;
+	case LOCKSTEP_AVX2 :
+		step = step_avx2;
+		break;
+	default :
+		step = step_scalar;
+		break;
+	}
+
+	struct timespec start;
+	struct timespec end;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	while (step(ls, &p) > 0) {
+		ls->steps++;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	ls->wall_sec = (end.tv_sec - start.tv_sec)
+			+ (end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+/* Returns a number drawn uniformly from 0 up to but not including range, using
+ * the high bits of r, which are the most random bits of an LCG */
+static inline __attribute__((always_inline)) int draw(uint32_t r, int range)
+{
+	return (int) (((uint64_t) r * (uint32_t) range) >> 32);
+}
+
+/* Handles the next event of every lane that has not reached FIN_TIME yet, and
+ * returns how many lanes still have. Every lane draws three random numbers per
+ * step whatever its event is, and every branch is a select, so the vector
+ * steps below can handle LOCKSTEP_WIDTH lanes at once the same way. A lane with
+ * an event at FIN_TIME is done, as SIM_FIN comes before any other event at that
+ * time.
+ */
+static int step_scalar(struct lockstep * ls, const struct lane_params * p)
+{
+	int live_lanes = 0;
+
+	for (int i = 0; i < ls->width; i++) {
+		int ta = *(ls->arrive_t + i);
+		int tc = *(ls->cpu_fin_t + i);
+		int t1 = *(ls->d1_fin_t + i);
+		int t2 = *(ls->d2_fin_t + i);
+		int nc = *(ls->cpu_size + i);
+		int n1 = *(ls->d1_size + i);
+		int n2 = *(ls->d2_size + i);
+
+		/* Next event of the lane, or FIN_TIME if that comes first */
+		int next = ta < tc ? ta : tc;
+		next = next < t1 ? next : t1;
+		next = next < t2 ? next : t2;
+		int live = next < p->fin_time;
+		int now = live ? next : p->fin_time;
+		int dt = now - *(ls->t + i);
+
+		*(ls->cpu_area + i) += (long long) nc * dt;
+		*(ls->d1_area + i) += (long long) n1 * dt;
+		*(ls->d2_area + i) += (long long) n2 * dt;
+		*(ls->cpu_busy_t + i) += nc > 0 ? dt : 0;
+		*(ls->d1_busy_t + i) += n1 > 0 ? dt : 0;
+		*(ls->d2_busy_t + i) += n2 > 0 ? dt : 0;
+		*(ls->t + i) = now;
+
+		uint32_t x = *(ls->rng + i);
+		uint32_t r1 = x = x * LCG_A + LCG_C;
+		uint32_t r2 = x = x * LCG_A + LCG_C;
+		uint32_t r3 = x = x * LCG_A + LCG_C;
+		if (live) {
+			*(ls->rng + i) = x;
+		}
+
+		/* Which event it is, with ties going to arrivals, then the
+		 * cpu, then disk1 */
+		int is_a = live && ta == next;
+		int is_c = live && !is_a && tc == next;
+		int is_1 = live && !is_a && !is_c && t1 == next;
+		int is_2 = live && !is_a && !is_c && !is_1;
+		int quit = is_c && draw(r2, 1000) < p->quit_prob_i;
+		int to_d1 = is_c && !quit && n1 < n2;
+		int to_d2 = is_c && !quit && !(n1 < n2);
+
+		nc += is_a + is_1 + is_2 - is_c;
+		n1 += to_d1 - is_1;
+		n2 += to_d2 - is_2;
+
+		/* A station starts a job when its job finishes and another is
+		 * waiting, or when a job arrives to find it idle */
+		if (is_a) {
+			*(ls->arrive_t + i) = now + p->arrive_min
+					+ draw(r1, p->arrive_range);
+		}
+		if ((is_c && nc > 0) || (!is_c && live && nc == 1)) {
+			*(ls->cpu_fin_t + i) = now + p->cpu_min
+					+ draw(r3, p->cpu_range);
+		} else if (is_c) {
+			*(ls->cpu_fin_t + i) = LOCKSTEP_IDLE;
+		}
+		if ((is_1 && n1 > 0) || (to_d1 && n1 == 1)) {
+			*(ls->d1_fin_t + i) = now + p->d1_min
+					+ draw(r1, p->d1_range);
+		} else if (is_1) {
+			*(ls->d1_fin_t + i) = LOCKSTEP_IDLE;
+		}
+		if ((is_2 && n2 > 0) || (to_d2 && n2 == 1)) {
+			*(ls->d2_fin_t + i) = now + p->d2_min
+					+ draw(r1, p->d2_range);
+		} else if (is_2) {
+			*(ls->d2_fin_t + i) = LOCKSTEP_IDLE;
+		}
+		*(ls->cpu_size + i) = nc;
+		*(ls->d1_size + i) = n1;
+		*(ls->d2_size + i) = n2;
+
+		*(ls->cpu_comp_jobs + i) += is_c;
+		*(ls->d1_comp_jobs + i) += is_1;
+		*(ls->d2_comp_jobs + i) += is_2;
+		*(ls->quits + i) += quit;
+		if (live) {
+			*(ls->cpu_cumul_len + i) += nc;
+			*(ls->d1_cumul_len + i) += n1;
+			*(ls->d2_cumul_len + i) += n2;
+			*(ls->num_lens + i) += 1;
+		}
+		if (*(ls->cpu_max + i) < nc) {
+			*(ls->cpu_max + i) = nc;
+		}
+		if (*(ls->d1_max + i) < n1) {
+			*(ls->d1_max + i) = n1;
+		}
+		if (*(ls->d2_max + i) < n2) {
+			*(ls->d2_max + i) = n2;
+		}
+		live_lanes += live;
+	}
+
+	return live_lanes;
+}
+
+/* Vectors of LOCKSTEP_WIDTH lanes. Comparisons of them give -1 in each lane
+ * where they hold and 0 elsewhere, which is used as a mask */
+typedef int32_t vint __attribute__((vector_size(4 * LOCKSTEP_WIDTH)));
+typedef uint32_t vuint __attribute__((vector_size(4 * LOCKSTEP_WIDTH)));
+typedef int64_t vlong __attribute__((vector_size(8 * LOCKSTEP_WIDTH)));
+typedef uint64_t vulong __attribute__((vector_size(8 * LOCKSTEP_WIDTH)));
+
+/* Helpers on vectors are macros, as passing vectors wider than the default
+ * instruction set's registers to functions changes the ABI */
+
+/* Picks a where mask m is set and b elsewhere */
+#define SEL(m, a, b) (((a) & (m)) | ((b) & ~(m)))
+
+/* draw for a vector of random numbers */
+#define DRAW_V(r, range) __builtin_convertvector((__builtin_convertvector( \
+		(r), vulong) * (uint64_t) (range)) >> 32, vint)
+
+/* Widens x and adds it to the 64 bit accumulators at acc */
+#define ADD_V(acc, x) (*(vlong *) (acc) += __builtin_convertvector((x), \
+		vlong))
+
+/* step_scalar, done LOCKSTEP_WIDTH lanes at a time with masks in place of the
+ * branches. Built once for each instruction set below, which decides how many
+ * hardware vectors make up one of these vectors.
+ */
+static inline __attribute__((always_inline)) int step_vector(
+		struct lockstep * ls, const struct lane_params * p)
+{
+	vint live_lanes = { 0 };
+
+	for (int i = 0; i < ls->width; i += LOCKSTEP_WIDTH) {
+		vint ta = *(vint *) (ls->arrive_t + i);
+		vint tc = *(vint *) (ls->cpu_fin_t + i);
+		vint t1 = *(vint *) (ls->d1_fin_t + i);
+		vint t2 = *(vint *) (ls->d2_fin_t + i);
+		vint nc = *(vint *) (ls->cpu_size + i);
+		vint n1 = *(vint *) (ls->d1_size + i);
+		vint n2 = *(vint *) (ls->d2_size + i);
+		vint zero = nc - nc;
+		vint idle = zero + LOCKSTEP_IDLE;
+
+		vint next = SEL(ta < tc, ta, tc);
+		next = SEL(next < t1, next, t1);
+		next = SEL(next < t2, next, t2);
+		vint live = next < p->fin_time;
+		vint now = SEL(live, next, zero + p->fin_time);
+		vint dt = now - *(vint *) (ls->t + i);
+
+		*(vlong *) (ls->cpu_area + i) += __builtin_convertvector(nc,
+				vlong) * __builtin_convertvector(dt, vlong);
+		*(vlong *) (ls->d1_area + i) += __builtin_convertvector(n1,
+				vlong) * __builtin_convertvector(dt, vlong);
+		*(vlong *) (ls->d2_area + i) += __builtin_convertvector(n2,
+				vlong) * __builtin_convertvector(dt, vlong);
+		ADD_V(ls->cpu_busy_t + i, dt & (nc > 0));
+		ADD_V(ls->d1_busy_t + i, dt & (n1 > 0));
+		ADD_V(ls->d2_busy_t + i, dt & (n2 > 0));
+		*(vint *) (ls->t + i) = now;
+
+		vuint x = *(vuint *) (ls->rng + i);
+		vuint r1 = x = x * LCG_A + LCG_C;
+		vuint r2 = x = x * LCG_A + LCG_C;
+		vuint r3 = x = x * LCG_A + LCG_C;
+		*(vint *) (ls->rng + i) = SEL(live, (vint) x,
+				*(vint *) (ls->rng + i));
+
+		vint is_a = live & (ta == next);
+		vint is_c = live & ~is_a & (tc == next);
+		vint is_1 = live & ~is_a & ~is_c & (t1 == next);
+		vint is_2 = live & ~is_a & ~is_c & ~is_1;
+		vint quit = is_c & (DRAW_V(r2, 1000) < p->quit_prob_i);
+		vint to_d1 = is_c & ~quit & (n1 < n2);
+		vint to_d2 = is_c & ~quit & ~(n1 < n2);
+
+		/* Masks are -1 where set, so adding one is subtracting it */
+		nc += is_c - is_a - is_1 - is_2;
+		n1 += is_1 - to_d1;
+		n2 += is_2 - to_d2;
+
+		vint cpu_start = (is_c & (nc > 0)) | (~is_c & live
+				& (nc == 1));
+		vint d1_start = (is_1 & (n1 > 0)) | (to_d1 & (n1 == 1));
+		vint d2_start = (is_2 & (n2 > 0)) | (to_d2 & (n2 == 1));
+
+		*(vint *) (ls->arrive_t + i) = SEL(is_a, now + p->arrive_min
+				+ DRAW_V(r1, p->arrive_range), ta);
+		*(vint *) (ls->cpu_fin_t + i) = SEL(cpu_start, now + p->cpu_min
+				+ DRAW_V(r3, p->cpu_range), SEL(is_c, idle, tc));
+		*(vint *) (ls->d1_fin_t + i) = SEL(d1_start, now + p->d1_min
+				+ DRAW_V(r1, p->d1_range), SEL(is_1, idle, t1));
+		*(vint *) (ls->d2_fin_t + i) = SEL(d2_start, now + p->d2_min
+				+ DRAW_V(r1, p->d2_range), SEL(is_2, idle, t2));
+		*(vint *) (ls->cpu_size + i) = nc;
+		*(vint *) (ls->d1_size + i) = n1;
+		*(vint *) (ls->d2_size + i) = n2;
+
+		ADD_V(ls->cpu_comp_jobs + i, -is_c);
+		ADD_V(ls->d1_comp_jobs + i, -is_1);
+		ADD_V(ls->d2_comp_jobs + i, -is_2);
+		ADD_V(ls->quits + i, -quit);
+		ADD_V(ls->cpu_cumul_len + i, nc & live);
+		ADD_V(ls->d1_cumul_len + i, n1 & live);
+		ADD_V(ls->d2_cumul_len + i, n2 & live);
+		ADD_V(ls->num_lens + i, -live);
+		vint * max = (vint *) (ls->cpu_max + i);
+		*max = SEL(*max < nc, nc, *max);
+		max = (vint *) (ls->d1_max + i);
+		*max = SEL(*max < n1, n1, *max);
+		max = (vint *) (ls->d2_max + i);
+		*max = SEL(*max < n2, n2, *max);
+		live_lanes -= live;
+	}
+
+	int retval = 0;
+	for (int j = 0; j < LOCKSTEP_WIDTH; j++) {
+		retval += live_lanes[j];
+	}
+	return retval;
+}
+
+/* The vector step built for each instruction set. The 32 bit fields of
+ * LOCKSTEP_WIDTH lanes fill one AVX2 register, and their 64 bit accumulators
+ * take two AVX2 registers or one AVX-512 register */
+__attribute__((target("avx2")))
+static int step_avx2(struct lockstep * ls, const struct lane_params * p)
+{
+	return step_vector(ls, p);
+}
+
+__attribute__((target("avx512f,avx512vl,avx512bw,avx512dq")))
+static int step_avx512(struct lockstep * ls, const struct lane_params * p)
+{
+	return step_vector(ls, p);
+}
+
+/* Prints the mean of a statistic over the lanes, with the half width of its 95%
+ * confidence interval */
+static void record_metric(const char * name, double * x, int n,
+		FILE * stats_file)
+{
+	double sum = 0;
+	for (int i = 0; i < n; i++) {
+		sum += *(x + i);
+	}
+	double mean = sum / n;
+
+	double sq = 0;
+	for (int i = 0; i < n; i++) {
+		sq += (*(x + i) - mean) * (*(x + i) - mean);
+	}
+	double half = n > 1 ? 1.96 * sqrt(sq / (n - 1) / n) : 0;
+
+	fprintf(stats_file, "%s = %lf +- %lf\n", name, mean, half);
+}
+
+/* Prints the statistics of every lane, averaged over the lanes with 95%
+ * confidence intervals, to stats file. Lanes keep no arrival times, so in place
+ * of the average response time of record_stats each station gets the time jobs
+ * spent at it, those still there at FIN_TIME included, divided by the jobs it
+ * finished. This is the response time by Little's law while the station keeps
+ * up, and grows past it when a queue is left at FIN_TIME.
+ */
+void record_lockstep(struct lockstep * ls, FILE * stats_file)
+{
+	int n = ls->lanes;
+	double sim_tot_t = ls->fin_time - ls->init_time;
+	double * x = malloc(sizeof(double) * n);
+
+	fprintf(stats_file, "LOCKSTEP (%d replications, %s, %lld steps in %.3lf s)\n",
+			n, isa_names[ls->isa], ls->steps, ls->wall_sec);
+	fprintf(stats_file, "\n");
+
+	const char * names[3] = { "CPU", "Disk1", "Disk2" };
+	long long * cumul_len[3] = { ls->cpu_cumul_len, ls->d1_cumul_len,
+			ls->d2_cumul_len };
+	int * max[3] = { ls->cpu_max, ls->d1_max, ls->d2_max };
+	long long * area[3] = { ls->cpu_area, ls->d1_area, ls->d2_area };
+	long long * busy_t[3] = { ls->cpu_busy_t, ls->d1_busy_t,
+			ls->d2_busy_t };
+	long long * comp_jobs[3] = { ls->cpu_comp_jobs, ls->d1_comp_jobs,
+			ls->d2_comp_jobs };
+	char name[64];
+
+	for (int s = 0; s < 3; s++) {
+		for (int i = 0; i < n; i++) {
+			*(x + i) = *(cumul_len[s] + i)
+					/ (double) *(ls->num_lens + i);
+		}
+		snprintf(name, sizeof(name), "%s avg queue size", names[s]);
+		record_metric(name, x, n, stats_file);
+
+		for (int i = 0; i < n; i++) {
+			*(x + i) = *(max[s] + i);
+		}
+		snprintf(name, sizeof(name), "%s max queue size", names[s]);
+		record_metric(name, x, n, stats_file);
+
+		for (int i = 0; i < n; i++) {
+			*(x + i) = *(busy_t[s] + i) * 100 / sim_tot_t;
+		}
+		snprintf(name, sizeof(name), "%s utilization (%%)", names[s]);
+		record_metric(name, x, n, stats_file);
+
+		for (int i = 0; i < n; i++) {
+			*(x + i) = *(area[s] + i)
+					/ (double) *(comp_jobs[s] + i);
+		}
+		snprintf(name, sizeof(name),
+				"%s time at station per job finished",
+				names[s]);
+		record_metric(name, x, n, stats_file);
+
+		for (int i = 0; i < n; i++) {
+			*(x + i) = *(comp_jobs[s] + i) * 100 / sim_tot_t;
+		}
+		snprintf(name, sizeof(name),
+				"%s throughput (per 100 units of time)",
+				names[s]);
+		record_metric(name, x, n, stats_file);
+		fprintf(stats_file, "\n");
+	}
+
+	for (int i = 0; i < n; i++) {
+		*(x + i) = *(ls->quits + i);
+	}
+	record_metric("Jobs completed", x, n, stats_file);
+
+	free(x);
+}
@@ -0,0 +1,67 @@
+#ifndef LOCKSTEP_H
+#define LOCKSTEP_H
+
+#include <stdint.h>
+
+/* Instruction sets the lanes can be stepped with */
+#define LOCKSTEP_SCALAR 0
+#define LOCKSTEP_AVX2 1
+#define LOCKSTEP_AVX512 2
+
+/* Lanes stepped together by one vector step, chosen so the 64 bit accumulators
+ * of a step fit one AVX-512 register. Lane arrays are padded out to a multiple
+ * of it */
+#define LOCKSTEP_WIDTH 8
+
+/* Many replications of the single server cpu/disk model, differing only in
+ * seed, run side by side. Each replication is a lane, and every field holds
+ * one value per lane so one step of all lanes is a handful of vector
+ * instructions per field.
+ */
+struct lockstep
+{
+	int lanes;		// Number of replications
+	int width;		// Number of lanes allocated
+	int isa;		// Instruction set the steps are run with
+	int init_time;
+	int fin_time;
+	long long steps;	// Number of steps taken
+	double wall_sec;	// Seconds spent running
+
+	/* State of each lane */
+	int * t;		// Time of the lane's latest event
+	int * arrive_t;		// Time of the next arrival
+	int * cpu_fin_t;	// Time the job at each station finishes,
+	int * d1_fin_t;		// LOCKSTEP_IDLE if none
+	int * d2_fin_t;
+	int * cpu_size;		// Jobs at each station
+	int * d1_size;
+	int * d2_size;
+	uint32_t * rng;		// Random number generator of each lane
+
+	/* Accumulators of each lane */
+	int * cpu_max;		// Largest size reached by each station
+	int * d1_max;
+	int * d2_max;
+	long long * cpu_cumul_len;	// Sum of sizes after every event
+	long long * d1_cumul_len;
+	long long * d2_cumul_len;
+	long long * num_lens;		// Number of events
+	long long * cpu_area;		// Sum of size times time at that size
+	long long * d1_area;
+	long long * d2_area;
+	long long * cpu_busy_t;		// Time each station was busy
+	long long * d1_busy_t;
+	long long * d2_busy_t;
+	long long * cpu_comp_jobs;	// Jobs finished by each station
+	long long * d1_comp_jobs;
+	long long * d2_comp_jobs;
+	long long * quits;		// Jobs that quit
+};
+
+struct lockstep * init_lockstep(struct config * conf);
+void kill_lockstep(struct lockstep * ls);
+void run_lockstep(struct lockstep * ls, struct config * conf);
+void record_lockstep(struct lockstep * ls, FILE * stats_file);
+
+#endif /* not defined LOCKSTEP_H */
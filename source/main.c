@@ -1,77 +1,40 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
-#include <math.h>
 #include <string.h>
-#include "min_heap.h"
-#include "queue.h"
-
-/* These definitions are used to define what type of job an event is and used in
- * a case statement to decide how the simulation should handle each particular
- * event.
- */
-#define SIM_FIN -1
-#define JOB_ARRIVES 0
-#define CPU_FINISHED 1
-#define DISK1_FINISHED 2
-#define DISK2_FINISHED 3
-
-/* Structure to hold config values. */
-struct config
-{
-	int seed;
-	int init_time;
-	int fin_time;
-	int arrive_min;
-	int arrive_max;
-	double quit_prob;
-	int cpu_min;
-	int cpu_max;
-	int disk1_min;
-	int disk1_max;
-	int disk2_min;
-	int disk2_max;
-};
-
-/* Structure to hold statistic values. */
-struct statistics
-{
-	int cpu_max;		// Largest size reached by cpu queue
-	int d1_max;		// Largest size reached by disk1 queue
-	int d2_max;		// Largest size reached by disk2 queue
-	int cpu_cumul_len;	// Sum of all lengths of cpu queue
-	int d1_cumul_len;	// Sum of all lengths of disk1 queue
-	int d2_cumul_len;	// Sum of all lengths of disk2 queue
-	int cpu_num_lens;	// Number of lengths summed for cpu queue
-	int d1_num_lens;	// Number of lengths summed for disk1 queue
-	int d2_num_lens;	// Number of lengths summed for disk2 queue
-	int cpu_tot_busy_t;	// How much time the cpu was busy
-	int d1_tot_busy_t;	// How much time disk1 was busy
-	int d2_tot_busy_t;	// How much time disk2 was busy
-	int sim_tot_t;		// Total time of simulation
-	int cpu_tot_resp_t;	// Total response time of cpu
-	int d1_tot_resp_t;	// Total response time of disk1
-	int d2_tot_resp_t;	// Total response time of disk2
-	int cpu_max_resp_t;	// Maximum response time from cpu
-	int d1_max_resp_t;	// Maximum response time from disk1
-	int d2_max_resp_t;	// Maximum response time from disk2
-	int cpu_comp_jobs;	// Total number of completed jobs by cpu
-	int d1_comp_jobs;	// Total number of completed jobs by disk1
-	int d2_comp_jobs;	// Total number of completed jobs by disk2
-};
+#include <limits.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "config.h"
+#include "analytic.h"
+#include "sim.h"
+#include "lockstep.h"
 
 /* Gets config values from config file and records these values to log file */
-void parse_config(struct config * conf, FILE * log_file, FILE * stats_file);
-/* Calcs when job time occurs given configuration, current time, and job type */
-int calc_job_time(struct config * conf, int t, int x);
-/* Calcs whether or not job should quit, given configuarion */
-bool quit_job(struct config * conf);
-/* Prints statistics to stats file */
-void record_stats(struct statistics * stats, FILE * stats_file);
+void parse_config(struct config * conf, const char * overrides,
+		FILE * log_file, FILE * stats_file);
+/* Sets the config value named by option to value */
+void parse_option(struct config * conf, char * option, char * value);
+/* Applies the OPTION=VALUE overrides of a branch */
+void parse_overrides(struct config * conf, const char * overrides,
+		FILE * log_file, FILE * stats_file);
+/* Sets a value of a job class config, returns false if key is not one */
+bool parse_class_option(struct class_config * cls, char * key, char * value);
+/* Fills in and checks the config of each job class */
+void check_classes(struct config * conf);
 /* Creates config, and parses it, returns pointer to conf structure */
-struct config * init_conf(FILE * log_file, FILE * stats_file);
-/* Creates stats, and inits values properly, returns pointer to stats struct */
-struct statistics * init_stats(struct config * conf);
+struct config * init_conf(FILE * log_file, FILE * stats_file,
+		const char * overrides);
+/* Function to free a config */
+void kill_conf(struct config * conf);
+/* Forks a process for each branch, returns the branch this process runs */
+int fork_branches(struct config * conf, pid_t * pids);
+/* Switches this process to the files of a branch, returns its config */
+struct config * open_branch(struct config * conf, int k, int t,
+		FILE ** log_file, FILE ** stats_file);
+/* Waits for every branch to finish and lists them in stats file */
+void wait_branches(struct config * conf, pid_t * pids, FILE * stats_file);
 
 /* Driver Method */
 int main()
@@ -87,282 +50,95 @@ int main()
 	fprintf(stats_file, "STARTING NEW SIMULATION\n");
 	fprintf(stats_file, "~~~~~~~~~~~~~~~~~~~~~~~\n");
 
-	struct config * conf = init_conf(log_file, stats_file);
-
-	struct statistics * stats = init_stats(conf);
-
-	struct queue * cpu = init_queue();
-	struct queue * disk1 = init_queue();
-	struct queue * disk2 = init_queue();
-	struct min_heap * to_do = init_heap();
-	srand(conf->seed);
-
-	/* START SIMULATION */
-	struct event * new_e;
-	new_e = create_event(conf->fin_time, -1, SIM_FIN);
-	heap_push(to_do, new_e);
-	new_e = create_event(conf->init_time, 1, JOB_ARRIVES);
-	heap_push(to_do, new_e);
-
-	struct event * curr_e;	// Current event (changes with each pass)
-	struct node * comp_job;	// Completed jobs when queues are popped
-	int t;			// Current time (changes with each pass)
-	int job;		// Current job number (Changes with each pass)
-	int type;		// Current job type (Changes with each pass)
-	int job_count = 1;	// Total number of jobs created (excluding end)
-	int fin_t;		// Used to calculate fin times for certain jobs
-	int cpu_start_work;	// Tracks start time of latest cpu job
-	int d1_start_work;	// Tracks start time of latest disk1 job
-	int d2_start_work;	// Tracks start timr of latest disk2 job
-	while (!heap_is_empty(to_do)) {
-		/* Get current event */
-		curr_e = heap_pop(to_do);
-		t = curr_e->time;
-		job = curr_e->job;
-		type = curr_e->type;
-
-		/* Handle event */
-		switch (type) {
-		case JOB_ARRIVES :
-			/* Current event is a job arrival event, so it
-			 * must now be sent to the cpu or quit.
-			 * Determining next job arrival is also handled here so
-			 * that jobs arrive at more regular intervals. */
-
-			/* Determing next job arrival and add the event to
-			 * heap */
-			fin_t = calc_job_time(conf, t, JOB_ARRIVES);
-			new_e = create_event(fin_t, job_count + 1, JOB_ARRIVES);
-			heap_push(to_do, new_e);
-
-			fprintf(log_file, "%d: Job%d arrives\n", t, job);
-
-			/* If cpu is idle, job can be handled immediately. If
-			 * not, add to cpu queue and handle it later */
-			if (queue_is_empty(cpu)) {
-				fin_t = calc_job_time(conf, t, CPU_FINISHED);
-				new_e = create_event(fin_t, job, CPU_FINISHED);
-				heap_push(to_do, new_e);
-				queue_push(cpu, t, job);
-
-				cpu_start_work = t;
+	struct config * conf = init_conf(log_file, stats_file, NULL);
+
+	/* SIMULATION
+	 * Replications run in lockstep take the place of the single event
+	 * driven simulation */
+	struct sim * sim = NULL;
+	struct lockstep * ls = NULL;
+	pid_t * pids = NULL;	// Processes running each branch, in the parent
+	if (conf->analytic == ANALYTIC_ONLY) {
+		/* Nothing is simulated, only the analytic results are printed */
+	} else if (conf->pop_sweep) {
+		sim = init_sim(conf, log_file);
+		sweep_sim(sim);
+	} else if (conf->replications > 0) {
+		ls = init_lockstep(conf);
+		run_lockstep(ls, conf);
+		fprintf(log_file, "%d replications run in lockstep\n",
+				conf->replications);
+	} else {
+		sim = init_sim(conf, log_file);
+		run_sim(sim);
+
+		/* The simulation pauses at BRANCH_TIME to fork a process for
+		 * each BRANCH, and every process, this one included, runs on
+		 * from there with its own config and statistics */
+		if (sim->paused) {
+			pids = malloc(sizeof(pid_t) * conf->num_branches);
+			int branch = fork_branches(conf, pids);
+			if (branch > 0) {
+				free(pids);
+				pids = NULL;
+				struct config * branch_conf = open_branch(conf,
+						branch, sim->t, &log_file,
+						&stats_file);
+				branch_sim(sim, branch_conf, log_file, branch);
+				kill_conf(conf);
+				conf = branch_conf;
 			} else {
-				queue_push(cpu, t, job);
-			}
-
-			break;
-		case CPU_FINISHED :
-			/* Current event is a cpu finished event, so it must be
-			 * sent to a disk, or abandoned if the job is finished
-			 * (Whether it is finished or not is determined by
-			 * quit_prob) */
-
-			fprintf(log_file, "%d: Job%d finishes at CPU\n", t,
-					job);
-
-			comp_job = queue_pop(cpu);
-
-			/* Some stat handling */
-			stats->cpu_tot_busy_t += t - cpu_start_work;
-			stats->cpu_tot_resp_t += t - comp_job->time;
-			stats->cpu_comp_jobs++;
-			if (stats->cpu_max_resp_t < t - comp_job->time) {
-				stats->cpu_max_resp_t = t - comp_job->time;
+				branch_sim(sim, conf, log_file, 0);
 			}
-
-			/* Either quits job, or sends to disk1 or disk2
-			 * (Whichever has less jobs queued)
-			 */
-			if (quit_job(conf)) {
-				fprintf(log_file, "%d: Job%d quitting\n", t,
-						job);
-			} else if (disk1->size < disk2->size) {
-				if (queue_is_empty(disk1)) {
-					/* Create new event for heap */
-					fin_t = calc_job_time(conf, t,
-							DISK1_FINISHED);
-					new_e = create_event(fin_t, job,
-							DISK1_FINISHED);
-					heap_push(to_do, new_e);
-					queue_push(disk1, t, job);
-
-					d1_start_work = t;
-				} else {
-					queue_push(disk1, t, job);
-				}
-			} else { // disk2 < disk1
-				if (queue_is_empty(disk2)) {
-					/* Create new event for heap */
-					fin_t = calc_job_time(conf, t,
-							DISK2_FINISHED);
-					new_e = create_event(fin_t, job,
-							DISK2_FINISHED);
-					heap_push(to_do, new_e);
-					queue_push(disk2, t, job);
-
-					d2_start_work = t;
-				} else {
-					queue_push(disk2, t, job);
-				}
-			}
-
-			/* Calculates finish time for new job at cpu, now that
-			 * the cpu is finished with the old job
-			 */
-			if (!queue_is_empty(cpu)) {
-				fin_t = calc_job_time(conf, t, CPU_FINISHED);
-				new_e = create_event(fin_t,
-						queue_peek(cpu)->job,
-						CPU_FINISHED);
-				heap_push(to_do, new_e);
-
-				cpu_start_work = t;
-			}
-
-			break;
-		case DISK1_FINISHED :
-			/* Current event is a disk1 finished event, so it must
-			 * be sent to the cpu
-			 */
-
-			fprintf(log_file, "%d: Job%d finishes at disk1\n", t,
-					job);
-			comp_job = queue_pop(disk1);
-
-			/* Some stat handling */
-			stats->d1_tot_busy_t += t - d1_start_work;
-			stats->d1_tot_resp_t += t - comp_job->time;
-			stats->d1_comp_jobs++;
-			if (stats->d1_max_resp_t < t - comp_job->time) {
-				stats->d1_max_resp_t = t - comp_job->time;
-			}
-
-			if (queue_is_empty(cpu)) {
-				fin_t = calc_job_time(conf, t, CPU_FINISHED);
-				new_e = create_event(fin_t, job, CPU_FINISHED);
-				heap_push(to_do, new_e);
-				queue_push(cpu, t, job);
-
-				cpu_start_work = t;
-			} else {
-				queue_push(cpu, t, job);
-			}
-
-			/* Calculates finish time for new job at disk1 if it
-			 * exists, now that disk1 is finished with the old job
-			 */
-			if (!queue_is_empty(disk1)) {
-				fin_t = calc_job_time(conf, t, DISK1_FINISHED);
-				new_e = create_event(fin_t,
-						queue_peek(disk1)->job,
-						DISK1_FINISHED);
-				heap_push(to_do, new_e);
-
-				d1_start_work = t;
-			}
-
-			free(comp_job);
-
-			break;
-		case DISK2_FINISHED :
-			/* Current event is a disk2 finished event, so it must
-			 * be sent to the cpu
-			 */
-
-			fprintf(log_file, "%d: Job%d finishes at disk2\n", t,
-					job);
-			comp_job = queue_pop(disk2);
-
-			/* Some stat handling */
-			stats->d2_tot_busy_t += t - d2_start_work;
-			stats->d2_tot_resp_t += t - comp_job->time;
-			stats->d2_comp_jobs++;
-			if (stats->d2_max_resp_t < t - comp_job->time) {
-				stats->d2_max_resp_t = t - comp_job->time;
-			}
-
-			if (queue_is_empty(cpu)) {
-				fin_t = calc_job_time(conf, t, CPU_FINISHED);
-				new_e = create_event(fin_t, job, CPU_FINISHED);
-				heap_push(to_do, new_e);
-				queue_push(cpu, t, job);
-
-				cpu_start_work = t;
-			} else {
-				queue_push(cpu, t, job);
-			}
-
-			/* Calculates finish time for new job at disk2 if it
-			 * exists, now that disk2 is finished with the old job
-			 */
-			if (!queue_is_empty(disk2)) {
-				fin_t = calc_job_time(conf, t, DISK2_FINISHED);
-				new_e = create_event(fin_t,
-						queue_peek(disk2)->job,
-						DISK2_FINISHED);
-				heap_push(to_do, new_e);
-
-				d2_start_work = t;
-			}
-
-			free(comp_job);
-
-			break;
-		case SIM_FIN :
-			fprintf(log_file, "%d: Simulation Finished\n", t);
-			goto EXIT_LOOP;
-		default :
-			fprintf(stderr, "unknown job type code\n");
-			exit(1);
+			run_sim(sim);
 		}
-
-		/* Statistics handling */
-		if (stats->cpu_max < cpu->size) {
-			stats->cpu_max = cpu->size;
-		}
-		stats->cpu_cumul_len += cpu->size;
-		stats->cpu_num_lens ++;
-
-		if (stats->d1_max < disk1->size) {
-			stats->d1_max = disk1->size;
-		}
-		stats->d1_cumul_len += disk1->size;
-		stats->d1_num_lens ++;
-
-		if (stats->d2_max < disk2->size) {
-			stats->d2_max = disk2->size;
-		}
-		stats->d2_cumul_len += disk2->size;
-		stats->d2_num_lens ++;
-
-		job_count++;
 	}
 
-EXIT_LOOP:
-
 	/* END SIMULATION
 	 * Add a new line to the log and stats to separate simulations and close
 	 * the files
 	 */
 	fprintf(log_file, "\n\n\n");
-	record_stats(stats, stats_file);
+	if (ls != NULL) {
+		record_lockstep(ls, stats_file);
+	} else if (sim != NULL) {
+		if (conf->num_branches > 0) {
+			fprintf(stats_file, "Statistics cover time %d to %d, after the branch point\n\n",
+					conf->branch_time, conf->fin_time);
+		}
+		record_sim(sim, stats_file);
+	}
+	if (pids != NULL) {
+		wait_branches(conf, pids, stats_file);
+		free(pids);
+	}
+	if (conf->analytic != ANALYTIC_OFF) {
+		struct analytic * a = init_analytic(conf);
+		if (conf->analytic == ANALYTIC_ON) {
+			fprintf(stats_file, "\n");
+		}
+		record_analytic(a, stats_file);
+		kill_analytic(a);
+	}
 	fprintf(stats_file, "\n\n\n");
 	fclose(log_file);
 	fclose(stats_file);
 
 	/* Free any malloced data */
-	free(conf);
-	free(stats);
-	kill_heap(to_do);
-	kill_queue(cpu);
-	kill_queue(disk1);
-	kill_queue(disk2);
+	if (sim != NULL) {
+		kill_sim(sim);
+	}
+	if (ls != NULL) {
+		kill_lockstep(ls);
+	}
+	kill_conf(conf);
 
 	return 0;
 }
 
-/* Calcs when job time occurs given configuration, current time, and job type */
-void parse_config(struct config * conf, FILE * log_file, FILE * stats_file)
+/* Gets config values from config file and records these values to log file */
+void parse_config(struct config * conf, const char * overrides,
+		FILE * log_file, FILE * stats_file)
 {
 	FILE * config_file = fopen("config", "r");
 
@@ -372,36 +148,15 @@ void parse_config(struct config * conf, FILE * log_file, FILE * stats_file)
 	}
 
 	char option[30];
-	char value[10];
-	while (fscanf(config_file, "%s %s", &option, &value) == 2) {
-		if (strcmp(option, "SEED") == 0) {
-			conf->seed = atoi(value);
-		} else if (strcmp(option, "INIT_TIME") == 0) {
-			conf->init_time = atoi(value);
-		} else if (strcmp(option, "FIN_TIME") == 0) {
-			conf->fin_time = atoi(value);
-		} else if (strcmp(option, "ARRIVE_MIN") == 0) {
-			conf->arrive_min = atoi(value);
-		} else if (strcmp(option, "ARRIVE_MAX") == 0) {
-			conf->arrive_max = atoi(value);
-		} else if (strcmp(option, "QUIT_PROB") == 0) {
-			conf->quit_prob = atof(value);
-		} else if (strcmp(option, "CPU_MIN") == 0) {
-			conf->cpu_min = atoi(value);
-		} else if (strcmp(option, "CPU_MAX") == 0) {
-			conf->cpu_max = atoi(value);
-		} else if (strcmp(option, "DISK1_MIN") == 0) {
-			conf->disk1_min = atoi(value);
-		} else if (strcmp(option, "DISK1_MAX") == 0) {
-			conf->disk1_max = atoi(value);
-		} else if (strcmp(option, "DISK2_MIN") == 0) {
-			conf->disk2_min = atoi(value);
-		} else if (strcmp(option, "DISK2_MAX") == 0) {
-			conf->disk2_max = atoi(value);
-		}
+	char value[256];
+	while (fscanf(config_file, "%29s %255s", option, value) == 2) {
+		parse_option(conf, option, value);
 		fprintf(log_file, "%s = %s\n", option, value);
 		fprintf(stats_file, "%s = %s\n", option, value);
 	}
+	if (overrides != NULL) {
+		parse_overrides(conf, overrides, log_file, stats_file);
+	}
 
 	/* Checks to make sure that config values are valid */
 	if (conf->init_time >= conf->fin_time) {
@@ -422,106 +177,198 @@ void parse_config(struct config * conf, FILE * log_file, FILE * stats_file)
 	} else if (conf->disk2_min >= conf->disk2_max) {
 		fprintf(stderr, "Error: DISK2_MIN must be less than DISK2_MAX\n");
 		exit(1);
+	} else if (conf->cpu_servers < 1 || conf->disk1_servers < 1
+			|| conf->disk2_servers < 1) {
+		fprintf(stderr, "Error: CPU_SERVERS, DISK1_SERVERS and DISK2_SERVERS must be >= 1\n");
+		exit(1);
+	} else if (conf->analytic < ANALYTIC_OFF
+			|| conf->analytic > ANALYTIC_ONLY) {
+		fprintf(stderr, "Error: ANALYTIC must be 0, 1 or 2\n");
+		exit(1);
+	} else if (conf->mva_pop < 0) {
+		fprintf(stderr, "Error: MVA_POP must be >= 0\n");
+		exit(1);
+	} else if (conf->sample_interval < 0) {
+		fprintf(stderr, "Error: SAMPLE_INTERVAL must be >= 0\n");
+		exit(1);
+	} else if (conf->metrics_shm[0] != '\0' && conf->metrics_shm[0] != '/') {
+		fprintf(stderr, "Error: METRICS_SHM must start with /\n");
+		exit(1);
+	} else if (conf->classes < 1 || conf->classes > MAX_CLASSES) {
+		fprintf(stderr, "Error: CLASSES must be >= 1 and <= %d\n",
+				MAX_CLASSES);
+		exit(1);
+	} else if (conf->event_mem_limit < 0) {
+		fprintf(stderr, "Error: EVENT_MEM_LIMIT must be >= 0\n");
+		exit(1);
+	} else if (conf->replications < 0) {
+		fprintf(stderr, "Error: REPLICATIONS must be >= 0\n");
+		exit(1);
+	} else if (conf->replications > 0 && (conf->cpu_servers != 1
+			|| conf->disk1_servers != 1 || conf->disk2_servers != 1
+			|| conf->classes != 1 || conf->trace_file[0] != '\0')) {
+		fprintf(stderr, "Error: REPLICATIONS needs one server per station, one class and no TRACE_FILE\n");
+		exit(1);
+	} else if (conf->num_branches > 0 && (conf->branch_time
+			<= conf->init_time || conf->branch_time
+			>= conf->fin_time)) {
+		fprintf(stderr, "Error: BRANCH_TIME must be greater than INIT_TIME and less than FIN_TIME\n");
+		exit(1);
+	} else if (conf->num_branches > 0 && (conf->replications > 0
+			|| conf->analytic == ANALYTIC_ONLY)) {
+		fprintf(stderr, "Error: BRANCH needs the event driven simulation to run\n");
+		exit(1);
+	} else if (conf->ipa && conf->classes != 1) {
+		fprintf(stderr, "Error: IPA needs one class\n");
+		exit(1);
+	} else if (conf->population < 0) {
+		fprintf(stderr, "Error: POPULATION must be >= 0\n");
+		exit(1);
+	} else if (conf->population > 0 && (conf->think_min < 0
+			|| conf->think_min >= conf->think_max)) {
+		fprintf(stderr, "Error: THINK_MIN must be >= 0 and less than THINK_MAX\n");
+		exit(1);
+	} else if (conf->population > 0 && (conf->classes != 1
+			|| conf->trace_file[0] != '\0' || conf->replications > 0
+			|| conf->ipa)) {
+		fprintf(stderr, "Error: POPULATION needs one class, no TRACE_FILE, REPLICATIONS or IPA\n");
+		exit(1);
+	} else if (conf->pop_sweep && (conf->population == 0
+			|| conf->analytic == ANALYTIC_ONLY
+			|| conf->num_branches > 0 || conf->sample_interval > 0
+			|| conf->metrics_shm[0] != '\0')) {
+		fprintf(stderr, "Error: POP_SWEEP needs POPULATION and the event driven simulation, with no BRANCH, SAMPLE_INTERVAL or METRICS_SHM\n");
+		exit(1);
 	}
+	check_classes(conf);
 
 	fprintf(stats_file, "\n");
 
 	fclose(config_file);
 }
 
-/* Calcs whether or not job should quit, given configuarion */
-int calc_job_time(struct config * conf, int t, int x)
+/* Sets the config value named by option to value */
+void parse_option(struct config * conf, char * option, char * value)
 {
-	int fin_t= rand();
-
-	switch (x) {
-	case JOB_ARRIVES :
-		fin_t %= (conf->arrive_max - conf->arrive_min);
-		fin_t += (conf->arrive_min + t);
-		break;
-	case CPU_FINISHED :
-		fin_t %= (conf->cpu_max - conf->cpu_min);
-		fin_t += (conf->cpu_min + t);
-		break;
-	case DISK1_FINISHED :
-		fin_t %= (conf->disk1_max - conf->disk1_min);
-		fin_t += (conf->disk2_min + t);
-		break;
-	case DISK2_FINISHED :
-		fin_t %= (conf->disk2_max - conf->disk2_min);
-		fin_t += (conf->disk2_min + t);
-		break;
-	default :
-		fprintf(stderr, "Error: Invalid job code for calc_job_time\n");
-		exit(1);
-		break;
-	}
+	char key[30];
+	int k;
 
-	return fin_t;
-}
-
-bool quit_job(struct config * conf)
-{
-	int x = rand() % 1000;
-
-	double temp = conf->quit_prob * 1000;
-	int quit_prob_i = (int) round(temp);
-	if (x < quit_prob_i) {
-		return true;
+	if (sscanf(option, "CLASS%d_%29s", &k, key) == 2) {
+		if (k < 0 || k >= MAX_CLASSES) {
+			fprintf(stderr, "Error: %s names a class past %d\n",
+					option, MAX_CLASSES - 1);
+			exit(1);
+		}
+		if (!parse_class_option(&conf->cls[k], key, value)) {
+			fprintf(stderr, "Error: Unknown class option %s\n",
+					option);
+			exit(1);
+		}
+	} else if (strcmp(option, "SEED") == 0) {
+		conf->seed = atoi(value);
+	} else if (strcmp(option, "INIT_TIME") == 0) {
+		conf->init_time = atoi(value);
+	} else if (strcmp(option, "FIN_TIME") == 0) {
+		conf->fin_time = atoi(value);
+	} else if (strcmp(option, "ARRIVE_MIN") == 0) {
+		conf->arrive_min = atoi(value);
+	} else if (strcmp(option, "ARRIVE_MAX") == 0) {
+		conf->arrive_max = atoi(value);
+	} else if (strcmp(option, "QUIT_PROB") == 0) {
+		conf->quit_prob = atof(value);
+	} else if (strcmp(option, "CPU_MIN") == 0) {
+		conf->cpu_min = atoi(value);
+	} else if (strcmp(option, "CPU_MAX") == 0) {
+		conf->cpu_max = atoi(value);
+	} else if (strcmp(option, "DISK1_MIN") == 0) {
+		conf->disk1_min = atoi(value);
+	} else if (strcmp(option, "DISK1_MAX") == 0) {
+		conf->disk1_max = atoi(value);
+	} else if (strcmp(option, "DISK2_MIN") == 0) {
+		conf->disk2_min = atoi(value);
+	} else if (strcmp(option, "DISK2_MAX") == 0) {
+		conf->disk2_max = atoi(value);
+	} else if (strcmp(option, "CPU_SERVERS") == 0) {
+		conf->cpu_servers = atoi(value);
+	} else if (strcmp(option, "DISK1_SERVERS") == 0) {
+		conf->disk1_servers = atoi(value);
+	} else if (strcmp(option, "DISK2_SERVERS") == 0) {
+		conf->disk2_servers = atoi(value);
+	} else if (strcmp(option, "TRACE_FILE") == 0) {
+		strcpy(conf->trace_file, value);
+	} else if (strcmp(option, "ANALYTIC") == 0) {
+		conf->analytic = atoi(value);
+	} else if (strcmp(option, "MVA_POP") == 0) {
+		conf->mva_pop = atoi(value);
+	} else if (strcmp(option, "PROFILE_HANDLERS") == 0) {
+		conf->profile_handlers = atoi(value) != 0;
+	} else if (strcmp(option, "SAMPLE_INTERVAL") == 0) {
+		conf->sample_interval = atoi(value);
+	} else if (strcmp(option, "METRICS_SHM") == 0) {
+		strcpy(conf->metrics_shm, value);
+	} else if (strcmp(option, "CLASSES") == 0) {
+		conf->classes = atoi(value);
+	} else if (strcmp(option, "PREEMPT") == 0) {
+		conf->preempt = atoi(value) != 0;
+	} else if (strcmp(option, "EVENT_MEM_LIMIT") == 0) {
+		conf->event_mem_limit = atol(value);
+	} else if (strcmp(option, "REPLICATIONS") == 0) {
+		conf->replications = atoi(value);
+	} else if (strcmp(option, "SIMD") == 0) {
+		conf->simd = atoi(value) != 0;
+	} else if (strcmp(option, "BRANCH_TIME") == 0) {
+		conf->branch_time = atoi(value);
+	} else if (strcmp(option, "BRANCH") == 0) {
+		conf->branches = realloc(conf->branches, sizeof(char *)
+				* (conf->num_branches + 1));
+		*(conf->branches + conf->num_branches) = strdup(value);
+		conf->num_branches++;
+	} else if (strcmp(option, "IPA") == 0) {
+		conf->ipa = atoi(value) != 0;
+	} else if (strcmp(option, "FAST_SCHED") == 0) {
+		conf->fast_sched = atoi(value) != 0;
+	} else if (strcmp(option, "POPULATION") == 0) {
+		conf->population = atoi(value);
+	} else if (strcmp(option, "THINK_MIN") == 0) {
+		conf->think_min = atoi(value);
+	} else if (strcmp(option, "THINK_MAX") == 0) {
+		conf->think_max = atoi(value);
+	} else if (strcmp(option, "POP_SWEEP") == 0) {
+		conf->pop_sweep = atoi(value) != 0;
 	}
-	return false;
 }
 
-/* Prints statistics to stats file */
-void record_stats(struct statistics * stats, FILE * stats_file)
+/* Applies the overrides of a BRANCH, which are OPTION=VALUE pairs separated by
+ * commas, and records them to log and stats file */
+void parse_overrides(struct config * conf, const char * overrides,
+		FILE * log_file, FILE * stats_file)
 {
-	fprintf(stats_file, "CPU avg queue size = %lf\n",
-			stats->cpu_cumul_len / (double) stats->cpu_num_lens);
-	fprintf(stats_file, "CPU max queue size = %d\n", stats->cpu_max);
-	fprintf(stats_file, "CPU utilization = %lf%%\n",
-			(stats->cpu_tot_busy_t * 100)
-			/ (double) stats->sim_tot_t);
-	fprintf(stats_file, "CPU avg response time = %lf\n",
-			stats->cpu_tot_resp_t / (double) stats->cpu_comp_jobs);
-	fprintf(stats_file, "CPU max response time = %d\n",
-			stats->cpu_max_resp_t);
-	fprintf(stats_file, "CPU throughput = %lf per 100 units of time\n",
-			(stats->cpu_comp_jobs * 100)
-			/ (double) stats->sim_tot_t);
-	fprintf(stats_file, "\n");
+	char * copy = strdup(overrides);
+	char * save;
+
+	for (char * pair = strtok_r(copy, ",", &save); pair != NULL;
+			pair = strtok_r(NULL, ",", &save)) {
+		char * value = strchr(pair, '=');
+		if (value == NULL || value == pair) {
+			fprintf(stderr, "Error: BRANCH %s is not OPTION=VALUE\n",
+					pair);
+			exit(1);
+		}
+		*value = '\0';
+		value++;
 
-	fprintf(stats_file, "Disk1 avg queue size = %lf\n",
-			stats->d1_cumul_len / (double) stats->d1_num_lens);
-	fprintf(stats_file, "Disk1 max queue size = %d\n", stats->d1_max);
-	fprintf(stats_file, "Disk1 utilization = %lf%%\n",
-			(stats->d1_tot_busy_t * 100)
-			/ (double) stats->sim_tot_t);
-	fprintf(stats_file, "Disk1 avg response time = %lf\n",
-			stats->d1_tot_resp_t / (double) stats->d1_comp_jobs);
-	fprintf(stats_file, "Disk1 max response time = %d\n",
-			stats->d1_max_resp_t);
-	fprintf(stats_file, "Disk1 throughput = %lf per 100 units of time\n",
-			(stats->d1_comp_jobs * 100)
-			/ (double) stats->sim_tot_t);
-	fprintf(stats_file, "\n");
+		parse_option(conf, pair, value);
+		fprintf(log_file, "%s = %s (branch)\n", pair, value);
+		fprintf(stats_file, "%s = %s (branch)\n", pair, value);
+	}
 
-	fprintf(stats_file, "Disk2 avg queue size = %lf\n",
-			stats->d2_cumul_len / (double) stats->d2_num_lens);
-	fprintf(stats_file, "Disk2 max queue size = %d\n", stats->d2_max);
-	fprintf(stats_file, "Disk2 utilization = %lf%%\n",
-			(stats->d2_tot_busy_t * 100)
-			/ (double) stats->sim_tot_t);
-	fprintf(stats_file, "Disk2 avg response time = %lf\n",
-			stats->d2_tot_resp_t / (double) stats->d2_comp_jobs);
-	fprintf(stats_file, "Disk2 max response time = %d\n",
-			stats->d2_max_resp_t);
-	fprintf(stats_file, "Disk2 throughput = %lf per 100 units of time\n",
-			(stats->d2_comp_jobs * 100)
-			/ (double) stats->sim_tot_t);
+	free(copy);
 }
 
-/* Creates config, and parses it, returns pointer to conf structure */
-struct config * init_conf(FILE * log_file, FILE * stats_file)
+/* Creates config, and parses it along with the overrides of a branch if there
+ * are any, returns pointer to conf structure */
+struct config * init_conf(FILE * log_file, FILE * stats_file,
+		const char * overrides)
 {
 	struct config * conf = malloc(sizeof(struct config));
 
@@ -538,39 +385,233 @@ struct config * init_conf(FILE * log_file, FILE * stats_file)
 	conf->disk1_max = 500;
 	conf->disk2_min = 50;
 	conf->disk2_max = 500;
+	conf->cpu_servers = 1;
+	conf->disk1_servers = 1;
+	conf->disk2_servers = 1;
+	conf->trace_file[0] = '\0';
+	conf->analytic = ANALYTIC_OFF;
+	conf->mva_pop = 0;
+	conf->profile_handlers = false;
+	conf->sample_interval = 0;
+	conf->metrics_shm[0] = '\0';
+	conf->classes = 1;
+	conf->preempt = false;
+	conf->event_mem_limit = 0;
+	conf->replications = 0;
+	conf->simd = true;
+	conf->branch_time = 0;
+	conf->branches = NULL;
+	conf->num_branches = 0;
+	conf->ipa = false;
+	conf->fast_sched = true;
+	conf->population = 0;
+	conf->think_min = 100;
+	conf->think_max = 500;
+	conf->pop_sweep = false;
+
+	/* Class values are marked unset so they can take the values for all
+	 * jobs once the whole file is read. The marks are INT_MIN and NAN, which
+	 * no config value is given, so a bad value is still caught as bad */
+	for (int k = 0; k < MAX_CLASSES; k++) {
+		struct class_config * cls = &conf->cls[k];
+		cls->arrive_min = INT_MIN;
+		cls->arrive_max = INT_MIN;
+		cls->quit_prob = NAN;
+		cls->cpu_min = INT_MIN;
+		cls->cpu_max = INT_MIN;
+		cls->disk1_min = INT_MIN;
+		cls->disk1_max = INT_MIN;
+		cls->disk2_min = INT_MIN;
+		cls->disk2_max = INT_MIN;
+	}
 
-	parse_config(conf, log_file, stats_file);
+	parse_config(conf, overrides, log_file, stats_file);
 	fprintf(log_file, "\n");
 
 	return conf;
 }
 
-/* Creates stats, and inits values properly, returns pointer to stats struct */
-struct statistics * init_stats(struct config * conf)
+/* Function to free a config */
+void kill_conf(struct config * conf)
+{
+	for (int k = 0; k < conf->num_branches; k++) {
+		free(*(conf->branches + k));
+	}
+	free(conf->branches);
+	free(conf);
+}
+
+/* Forks a process for each BRANCH of conf. Returns the number of the branch the
+ * calling process is to run, counting from 1, or 0 in the parent, which keeps
+ * the pid of each branch in pids. Buffered output is flushed first so that no
+ * branch writes it out again.
+ */
+int fork_branches(struct config * conf, pid_t * pids)
+{
+	fflush(NULL);
+
+	for (int k = 1; k <= conf->num_branches; k++) {
+		pid_t pid = fork();
+		if (pid < 0) {
+			fprintf(stderr, "Error: Could not fork branch %d\n", k);
+			exit(1);
+		} else if (pid == 0) {
+			return k;
+		}
+		*(pids + k - 1) = pid;
+	}
+
+	return 0;
+}
+
+/* Switches the process running branch k, which starts at time t, over to log
+ * and stats files of its own. Returns the config of the branch, which is conf
+ * with the overrides of the branch applied. Values the simulation was built
+ * around cannot be overridden.
+ */
+struct config * open_branch(struct config * conf, int k, int t,
+		FILE ** log_file, FILE ** stats_file)
+{
+	char name[32];
+
+	fclose(*log_file);
+	snprintf(name, sizeof(name), "log.branch%d", k);
+	*log_file = fopen(name, "a");
+	fprintf(*log_file, "STARTING BRANCH %d AT TIME %d\n", k, t);
+	fprintf(*log_file, "~~~~~~~~~~~~~~~~~~~~~~~\n");
+
+	fclose(*stats_file);
+	snprintf(name, sizeof(name), "stats.branch%d", k);
+	*stats_file = fopen(name, "a");
+	fprintf(*stats_file, "STARTING BRANCH %d AT TIME %d\n", k, t);
+	fprintf(*stats_file, "~~~~~~~~~~~~~~~~~~~~~~~\n");
+
+	struct config * new_conf = init_conf(*log_file, *stats_file,
+			*(conf->branches + k - 1));
+	if (new_conf->init_time != conf->init_time
+			|| new_conf->fin_time != conf->fin_time
+			|| new_conf->branch_time != conf->branch_time
+			|| new_conf->cpu_servers != conf->cpu_servers
+			|| new_conf->disk1_servers != conf->disk1_servers
+			|| new_conf->disk2_servers != conf->disk2_servers
+			|| new_conf->classes != conf->classes
+			|| new_conf->event_mem_limit != conf->event_mem_limit
+			|| new_conf->sample_interval != conf->sample_interval
+			|| new_conf->ipa != conf->ipa
+			|| new_conf->population != conf->population
+			|| strcmp(new_conf->trace_file, conf->trace_file) != 0) {
+		fprintf(stderr, "Error: BRANCH %d overrides a value that is fixed once the simulation starts\n",
+				k);
+		exit(1);
+	}
+
+	return new_conf;
+}
+
+/* Waits for the process of every branch to finish, and lists in stats file
+ * where the statistics of each branch went */
+void wait_branches(struct config * conf, pid_t * pids, FILE * stats_file)
+{
+	fprintf(stats_file, "\n");
+	for (int k = 1; k <= conf->num_branches; k++) {
+		int status;
+		waitpid(*(pids + k - 1), &status, 0);
+		if (WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+			fprintf(stats_file, "Branch %d (%s) statistics are in stats.branch%d\n",
+					k, *(conf->branches + k - 1), k);
+		} else {
+			fprintf(stats_file, "Branch %d (%s) failed\n", k,
+					*(conf->branches + k - 1));
+		}
+	}
+}
+
+/* Sets the value of a job class config named by key, which is an option name
+ * with its CLASSk_ prefix removed. Returns false if key names no class value.
+ */
+bool parse_class_option(struct class_config * cls, char * key, char * value)
 {
-	struct statistics * stats = malloc(sizeof(struct statistics));
-	stats->cpu_max = 0;
-	stats->d1_max = 0;
-	stats->d2_max = 0;
-	stats->cpu_cumul_len = 0;
-	stats->d1_cumul_len = 0;
-	stats->d2_cumul_len = 0;
-	stats->cpu_num_lens = 0;
-	stats->d1_num_lens = 0;
-	stats->d2_num_lens = 0;
-	stats->cpu_tot_busy_t = 0;
-	stats->d1_tot_busy_t = 0;
-	stats->d2_tot_busy_t = 0;
-	stats->sim_tot_t = conf->fin_time - conf->init_time;
-	stats->cpu_tot_resp_t = 0;
-	stats->d1_tot_resp_t = 0;
-	stats->d2_tot_resp_t = 0;
-	stats->cpu_max_resp_t = 0;
-	stats->d1_max_resp_t = 0;
-	stats->d2_max_resp_t = 0;
-	stats->cpu_comp_jobs = 0;
-	stats->d1_comp_jobs = 0;
-	stats->d2_comp_jobs = 0;
-
-	return stats;
+	if (strcmp(key, "ARRIVE_MIN") == 0) {
+		cls->arrive_min = atoi(value);
+	} else if (strcmp(key, "ARRIVE_MAX") == 0) {
+		cls->arrive_max = atoi(value);
+	} else if (strcmp(key, "QUIT_PROB") == 0) {
+		cls->quit_prob = atof(value);
+	} else if (strcmp(key, "CPU_MIN") == 0) {
+		cls->cpu_min = atoi(value);
+	} else if (strcmp(key, "CPU_MAX") == 0) {
+		cls->cpu_max = atoi(value);
+	} else if (strcmp(key, "DISK1_MIN") == 0) {
+		cls->disk1_min = atoi(value);
+	} else if (strcmp(key, "DISK1_MAX") == 0) {
+		cls->disk1_max = atoi(value);
+	} else if (strcmp(key, "DISK2_MIN") == 0) {
+		cls->disk2_min = atoi(value);
+	} else if (strcmp(key, "DISK2_MAX") == 0) {
+		cls->disk2_max = atoi(value);
+	} else {
+		return false;
+	}
+	return true;
+}
+
+/* Gives each job class the values for all jobs that its config left out, then
+ * checks that the values of each class in use are valid */
+void check_classes(struct config * conf)
+{
+	for (int k = 0; k < MAX_CLASSES; k++) {
+		struct class_config * cls = &conf->cls[k];
+		if (cls->arrive_min == INT_MIN) {
+			cls->arrive_min = conf->arrive_min;
+		}
+		if (cls->arrive_max == INT_MIN) {
+			cls->arrive_max = conf->arrive_max;
+		}
+		if (isnan(cls->quit_prob)) {
+			cls->quit_prob = conf->quit_prob;
+		}
+		if (cls->cpu_min == INT_MIN) {
+			cls->cpu_min = conf->cpu_min;
+		}
+		if (cls->cpu_max == INT_MIN) {
+			cls->cpu_max = conf->cpu_max;
+		}
+		if (cls->disk1_min == INT_MIN) {
+			cls->disk1_min = conf->disk1_min;
+		}
+		if (cls->disk1_max == INT_MIN) {
+			cls->disk1_max = conf->disk1_max;
+		}
+		if (cls->disk2_min == INT_MIN) {
+			cls->disk2_min = conf->disk2_min;
+		}
+		if (cls->disk2_max == INT_MIN) {
+			cls->disk2_max = conf->disk2_max;
+		}
+
+		if (k >= conf->classes) {
+			continue;
+		}
+		if (cls->arrive_min >= cls->arrive_max) {
+			fprintf(stderr, "Error: CLASS%d_ARRIVE_MIN must be less than CLASS%d_ARRIVE_MAX\n",
+					k, k);
+			exit(1);
+		} else if (cls->quit_prob < 0 || cls->quit_prob > 1) {
+			fprintf(stderr, "Error: CLASS%d_QUIT_PROB must be >= 0 and <= 1\n",
+					k);
+			exit(1);
+		} else if (cls->cpu_min >= cls->cpu_max) {
+			fprintf(stderr, "Error: CLASS%d_CPU_MIN must be less than CLASS%d_CPU_MAX\n",
+					k, k);
+			exit(1);
+		} else if (cls->disk1_min >= cls->disk1_max) {
+			fprintf(stderr, "Error: CLASS%d_DISK1_MIN must be less than CLASS%d_DISK1_MAX\n",
+					k, k);
+			exit(1);
+		} else if (cls->disk2_min >= cls->disk2_max) {
+			fprintf(stderr, "Error: CLASS%d_DISK2_MIN must be less than CLASS%d_DISK2_MAX\n",
+					k, k);
+			exit(1);
+		}
+	}
 }
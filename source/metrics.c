@@ -0,0 +1,112 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "metrics.h"
+
+/* Function to create (or take over) the shared memory segment called name and
+ * map it for writing. The segment is left behind when the simulation ends so
+ * its final snapshot can still be read.
+ */
+struct metrics * init_metrics(const char * name)
+{
+	int fd = shm_open(name, O_CREAT | O_RDWR, 0644);
+	if (fd < 0) {
+		fprintf(stderr, "Error: Could not create shared memory %s\n",
+				name);
+		exit(1);
+	}
+	if (ftruncate(fd, sizeof(struct metrics_shm)) < 0) {
+		fprintf(stderr, "Error: Could not size shared memory %s\n",
+				name);
+		exit(1);
+	}
+
+	struct metrics_shm * shm = mmap(NULL, sizeof(struct metrics_shm),
+			PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (shm == MAP_FAILED) {
+		fprintf(stderr, "Error: Could not map shared memory %s\n", name);
+		exit(1);
+	}
+
+	struct metrics * m = malloc(sizeof(struct metrics));
+	m->shm = shm;
+	snprintf(m->name, sizeof(m->name), "%s", name);
+
+	memset(&shm->snap, 0, sizeof(shm->snap));
+	__atomic_store_n(&shm->seq, 0, __ATOMIC_RELEASE);
+
+	return m;
+}
+
+/* Function to map an existing segment called name for reading */
+struct metrics * open_metrics(const char * name)
+{
+	int fd = shm_open(name, O_RDONLY, 0);
+	if (fd < 0) {
+		fprintf(stderr, "Error: No simulation is publishing to %s\n",
+				name);
+		exit(1);
+	}
+
+	struct metrics_shm * shm = mmap(NULL, sizeof(struct metrics_shm),
+			PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (shm == MAP_FAILED) {
+		fprintf(stderr, "Error: Could not map shared memory %s\n", name);
+		exit(1);
+	}
+
+	struct metrics * m = malloc(sizeof(struct metrics));
+	m->shm = shm;
+	snprintf(m->name, sizeof(m->name), "%s", name);
+
+	return m;
+}
+
+/* Function to unmap a segment and free its metrics */
+void kill_metrics(struct metrics * m)
+{
+	munmap(m->shm, sizeof(struct metrics_shm));
+	free(m);
+}
+
+/* Starts an update of the snapshot and returns it to be filled in. Must be
+ * followed by metrics_write_end. There is only ever one writer.
+ */
+struct metrics_snapshot * metrics_write_begin(struct metrics * m)
+{
+	uint32_t seq = __atomic_load_n(&m->shm->seq, __ATOMIC_RELAXED);
+	__atomic_store_n(&m->shm->seq, seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	return &m->shm->snap;
+}
+
+/* Finishes an update of the snapshot, making it visible to readers */
+void metrics_write_end(struct metrics * m)
+{
+	uint32_t seq = __atomic_load_n(&m->shm->seq, __ATOMIC_RELAXED);
+	__atomic_store_n(&m->shm->seq, seq + 1, __ATOMIC_RELEASE);
+}
+
+/* Copies a consistent snapshot into snap, retrying while the writer is in the
+ * middle of an update */
+void metrics_read(struct metrics * m, struct metrics_snapshot * snap)
+{
+	uint32_t before;
+	uint32_t after;
+
+	do {
+		before = __atomic_load_n(&m->shm->seq, __ATOMIC_ACQUIRE);
+		if (before % 2 == 1) {
+			after = before + 1;
+			continue;
+		}
+		memcpy(snap, (const void *) &m->shm->snap, sizeof(*snap));
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		after = __atomic_load_n(&m->shm->seq, __ATOMIC_RELAXED);
+	} while (before != after);
+}
@@ -0,0 +1,57 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdint.h>
+
+/* Number of events handled between updates of the live metrics */
+#define METRICS_PERIOD 4096
+
+/* Progress and running statistics of a simulation that is still running */
+struct metrics_snapshot
+{
+	int pid;		// Process running the simulation
+	int finished;		// Non zero once the simulation has ended
+	int init_time;
+	int fin_time;
+	int time;		// Current simulated time
+	long long events;	// Events handled so far
+	double events_per_sec;	// Events handled per second since last update
+	double wall_sec;	// Seconds since the simulation started
+	int cpu_size;		// Jobs at each station
+	int d1_size;
+	int d2_size;
+	int jobs_in_system;
+	long long jobs_done;	// Jobs that have quit
+	double cpu_util;	// Utilization of each station so far
+	double d1_util;
+	double d2_util;
+	double cpu_avg_resp_t;	// Average response time at each station so far
+	double d1_avg_resp_t;
+	double d2_avg_resp_t;
+	double avg_sojourn_t;	// Average time in system of jobs that quit
+};
+
+/* Layout of the shared memory segment. seq is odd while the snapshot is being
+ * written, and readers retry until they see the same even seq before and after
+ * copying the snapshot.
+ */
+struct metrics_shm
+{
+	uint32_t seq;
+	struct metrics_snapshot snap;
+};
+
+struct metrics
+{
+	struct metrics_shm * shm;
+	char name[256];
+};
+
+struct metrics * init_metrics(const char * name);
+struct metrics * open_metrics(const char * name);
+void kill_metrics(struct metrics * m);
+struct metrics_snapshot * metrics_write_begin(struct metrics * m);
+void metrics_write_end(struct metrics * m);
+void metrics_read(struct metrics * m, struct metrics_snapshot * snap);
+
+#endif /* not defined METRICS_H */
@@ -10,6 +10,8 @@
 
 static int sinkable(struct min_heap * h, int index, int index_left,
 		int index_right);
+static int cmp_event_key(const void * a, const void * b);
+static int cmp_watched(const void * a, const void * b);
 
 struct event * create_event(int time, int job, int type)
 {
@@ -17,6 +19,7 @@ struct event * create_event(int time, int job, int type)
 	e->time = time;
 	e->job = job;
 	e->type = type;
+	e->key = 0;
 
 	return e;
 }
@@ -28,6 +31,7 @@ struct min_heap * init_heap()
 	new_heap->arr = malloc(sizeof(struct event *) * INIT_CAPACITY);
 	new_heap->size = 0;
 	new_heap->capacity = INIT_CAPACITY;
+	new_heap->seq = 0;
 
 	for (int i = 0; i < new_heap->capacity; i++) {
 		*(new_heap->arr + i) = NULL;
@@ -64,6 +68,11 @@ static void grow_array(struct min_heap * heap)
 		*(new_arr + i) = *(heap->arr + i);
 	}
 
+	/* Clears the rest so kill_heap only frees events */
+	for (int i = heap->size; i < new_capacity; i++) {
+		*(new_arr + i) = NULL;
+	}
+
 	/* Frees old array */
 	free(heap->arr);
 
@@ -83,13 +92,26 @@ static void swap_event(struct event ** a, struct event ** b)
 
 /* Pushes data onto the heap */
 void heap_push(struct min_heap * heap, struct event * e)
+{
+	/* Stamps event with its key, renumbering the pending events first if
+	 * the sequence numbers have run out */
+	if (heap->seq == EVENT_SEQ_LIMIT) {
+		heap->seq = heap_renumber(heap, 0, NULL);
+	}
+	e->key = event_key(e->time, heap->seq++);
+	heap_push_keyed(heap, e);
+}
+
+/* Pushes data that already has its key onto the heap, for events whose push
+ * order is kept by someone else */
+void heap_push_keyed(struct min_heap * heap, struct event * e)
 {
 	/* Grow Array if needed */
 	if (heap->size >= heap->capacity) {
 		grow_array(heap);
 	}
 
-	/* Adds data entry to end of heap */
+	/* Adds event to end of heap */
 	*(heap->arr + heap->size) = e;
 
 	/* Reorganizes heap */
@@ -98,7 +120,7 @@ void heap_push(struct min_heap * heap, struct event * e)
 	struct event ** current = (heap->arr + index);
 	struct event ** parent = (heap->arr + index_parent);
 	/* CHECK'S FOR TOPS PARENT WHEN IT SHOULDN'T */
-	while ((*current)->time < (*parent)->time) {
+	while ((*current)->key < (*parent)->key) {
 		swap_event(current, parent);
 
 		index = (index - 1) / 2;
@@ -168,38 +190,26 @@ struct event * heap_pop(struct min_heap * heap)
 static int sinkable(struct min_heap * h, int index, int index_left,
 		int index_right)
 {
-	struct event * current = *(h->arr + index);
-	struct event * left = *(h->arr + index_left);
-	struct event * right = *(h->arr + index_right);
-	int retval = 0;
-	int c_t = current->time;
-	int l_t;
-	int r_t;
-
-	if ((h->arr + index_left) >= (h->arr + h->size)) {
-		retval = HEAP_NOT_SINKABLE;
-	} else if ((h->arr + index_right) >= (h->arr + h->size)) {
-		l_t = left->time;
-		if (l_t < c_t) {
-			retval = HEAP_SINKABLE_LEFT;
-		} else {
-			retval =  HEAP_NOT_SINKABLE;
-		}
-	} else { // Neither left nor right are null
-		l_t = left->time;
-		r_t = right->time;
-		if (l_t <= r_t && l_t < c_t) {
-			retval = HEAP_SINKABLE_LEFT;
-		} else if (r_t <= l_t && r_t < c_t) {
-			retval = HEAP_SINKABLE_RIGHT;
-		} else {
-			retval = HEAP_NOT_SINKABLE;
-		}
+	/* Children past the end of the heap do not exist */
+	if (index_left >= h->size) {
+		return HEAP_NOT_SINKABLE;
 	}
 
-	return retval;
-}
+	event_key_t c_k = (*(h->arr + index))->key;
+	event_key_t l_k = (*(h->arr + index_left))->key;
+	if (index_right >= h->size) {
+		return l_k < c_k ? HEAP_SINKABLE_LEFT : HEAP_NOT_SINKABLE;
+	}
 
+	/* Keys are unique, so the smaller child is strictly smaller */
+	event_key_t r_k = (*(h->arr + index_right))->key;
+	bool right = r_k < l_k;
+	event_key_t m_k = right ? r_k : l_k;
+	if (m_k >= c_k) {
+		return HEAP_NOT_SINKABLE;
+	}
+	return right ? HEAP_SINKABLE_RIGHT : HEAP_SINKABLE_LEFT;
+}
 
 bool heap_is_empty(struct min_heap * heap)
 {
@@ -217,6 +227,99 @@ struct event * heap_peek(struct min_heap * heap)
 	return *(heap->arr);
 }
 
+/* Gives the events in the heap new sequence numbers counting up from seq in
+ * key order, keeping their times, and returns the next sequence number. The
+ * order of the events is unchanged, so neither is the order they come out in,
+ * and sorting the array leaves it a heap. Watched keys of the events are moved
+ * along with them if kw is not NULL.
+ */
+uint32_t heap_renumber(struct min_heap * heap, uint32_t seq,
+		struct key_watch * kw)
+{
+	qsort(heap->arr, heap->size, sizeof(struct event *), cmp_event_key);
+	for (int i = 0; i < heap->size; i++) {
+		struct event * e = *(heap->arr + i);
+		event_key_t key = event_key(e->time, seq++);
+		if (kw != NULL) {
+			remap_key(kw, e->key, key);
+		}
+		e->key = key;
+	}
+	return seq;
+}
+
+/* Orders pointers to events by key for qsort */
+static int cmp_event_key(const void * a, const void * b)
+{
+	event_key_t ka = (*(struct event * const *) a)->key;
+	event_key_t kb = (*(struct event * const *) b)->key;
+	return (ka > kb) - (ka < kb);
+}
+
+/* Function to initialize a key watch with no keys */
+void init_key_watch(struct key_watch * kw)
+{
+	kw->keys = NULL;
+	kw->size = 0;
+	kw->capacity = 0;
+	kw->next = 0;
+}
+
+/* Function to free the keys of a key watch, which stay with their owners */
+void kill_key_watch(struct key_watch * kw)
+{
+	free(kw->keys);
+}
+
+/* Adds key to the watch, so it follows its event when renumbered */
+void watch_key(struct key_watch * kw, event_key_t * key)
+{
+	if (kw->size >= kw->capacity) {
+		kw->capacity = kw->capacity > 0 ? kw->capacity * 2 : 16;
+		kw->keys = realloc(kw->keys, sizeof(event_key_t *)
+				* kw->capacity);
+	}
+	*(kw->keys + kw->size) = key;
+	kw->size++;
+}
+
+/* Readies the watch for remap_key to be called for every pending event in key
+ * order */
+void remap_begin(struct key_watch * kw)
+{
+	qsort(kw->keys, kw->size, sizeof(event_key_t *), cmp_watched);
+	kw->next = 0;
+}
+
+/* Gives the watched keys equal to old, the key of a pending event, its new key.
+ * Watched keys between the last old key and this one belong to no pending event
+ * and are set to EVENT_KEY_MAX, so they cannot match any new key.
+ */
+void remap_key(struct key_watch * kw, event_key_t old, event_key_t key)
+{
+	while (kw->next < kw->size && **(kw->keys + kw->next) <= old) {
+		event_key_t * k = *(kw->keys + kw->next);
+		*k = *k == old ? key : EVENT_KEY_MAX;
+		kw->next++;
+	}
+}
+
+/* Clears the watched keys after the last pending event */
+void remap_end(struct key_watch * kw)
+{
+	for (; kw->next < kw->size; kw->next++) {
+		**(kw->keys + kw->next) = EVENT_KEY_MAX;
+	}
+}
+
+/* Orders pointers to watched keys by the key they point to for qsort */
+static int cmp_watched(const void * a, const void * b)
+{
+	event_key_t ka = **(event_key_t * const *) a;
+	event_key_t kb = **(event_key_t * const *) b;
+	return (ka > kb) - (ka < kb);
+}
+
 void print_event(struct event * e)
 {
 	if (e == NULL) {
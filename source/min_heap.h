@@ -1,11 +1,26 @@
 #ifndef MIN_HEAP_C
 #define MIN_HEAP_C
 
+#include <stdint.h>
+
+/* Key ordering events by time and then by push order, see event_key */
+typedef uint64_t event_key_t;
+
+/* Key later than that of any event */
+#define EVENT_KEY_MAX UINT64_MAX
+
+/* Sequence numbers are given up to but not including this one, then the
+ * pending events are renumbered from 0, see heap_renumber */
+#ifndef EVENT_SEQ_LIMIT
+#define EVENT_SEQ_LIMIT UINT32_MAX
+#endif
+
 struct event
 {
 	int time;
 	int job;
 	int type;
+	event_key_t key;	// Packed time and push order, see event_key
 };
 
 struct min_heap
@@ -13,15 +28,53 @@ struct min_heap
 	struct event ** arr;
 	int size;
 	int capacity;
+	uint32_t seq;		// Sequence number given to the next pushed event
+};
+
+/* Keys of pending events held outside of the structure they are pending in,
+ * such as the key of the finish event of each server, which are kept up to date
+ * when the pending events are renumbered */
+struct key_watch
+{
+	event_key_t ** keys;	// Watched keys
+	int size;
+	int capacity;
+	int next;		// Next key to remap while renumbering
 };
 
+/* Packs an event time and its insertion sequence number into a single key.
+ * The sign bit of time is flipped so that unsigned order matches signed order,
+ * and the sequence number in the low half breaks ties in FIFO order, so every
+ * pair of events is ordered by one unsigned compare. Sequence numbers stay
+ * below EVENT_SEQ_LIMIT, so no key reaches EVENT_KEY_MAX.
+ */
+static inline event_key_t event_key(int time, uint32_t seq)
+{
+	return ((uint64_t) ((uint32_t) time ^ 0x80000000u) << 32) | seq;
+}
+
+/* Time of the event a key was made for */
+static inline int key_time(event_key_t key)
+{
+	return (int) ((uint32_t) (key >> 32) ^ 0x80000000u);
+}
+
 struct event * create_event(int time, int job, int type);
 struct min_heap * init_heap();
 void kill_heap(struct min_heap * heap);
 void heap_push(struct min_heap * heap, struct event * e);
+void heap_push_keyed(struct min_heap * heap, struct event * e);
 struct event * heap_pop(struct min_heap * heap);
 bool heap_is_empty(struct min_heap * heap);
 struct event * heap_peek(struct min_heap * heap);
+uint32_t heap_renumber(struct min_heap * heap, uint32_t seq,
+		struct key_watch * kw);
+void init_key_watch(struct key_watch * kw);
+void kill_key_watch(struct key_watch * kw);
+void watch_key(struct key_watch * kw, event_key_t * key);
+void remap_begin(struct key_watch * kw);
+void remap_key(struct key_watch * kw, event_key_t old, event_key_t key);
+void remap_end(struct key_watch * kw);
 void print_event(struct event * e);
 void print_heap(struct min_heap * heap);
 
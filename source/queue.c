@@ -3,17 +3,27 @@
 #include <stdlib.h>
 #include "queue.h"
 
+static struct node * make_node(struct queue * q, int t, int x);
+
 struct queue * init_queue()
 {
 	struct queue * retval = malloc(sizeof(struct queue));
 	retval->head = NULL;
 	retval->tail = NULL;
 	retval->size = 0;
+	retval->spare = NULL;
 	return retval;
 }
 
 void kill_queue(struct queue * q)
 {
+	/* Frees the spare nodes */
+	while (q->spare != NULL) {
+		struct node * next = q->spare->next;
+		free(q->spare);
+		q->spare = next;
+	}
+
 	/* Catches case where q is empty */
 	if (q->size == 0) {
 		free(q);
@@ -38,14 +48,27 @@ void kill_queue(struct queue * q)
 	free(q);
 }
 
+/* Takes a spare node if there is one, or creates one, and sets its data */
+static struct node * make_node(struct queue * q, int t, int x)
+{
+	struct node * retval = q->spare;
+	if (retval != NULL) {
+		q->spare = retval->next;
+	} else {
+		retval = malloc(sizeof(struct node));
+	}
+	retval->job = x;
+	retval->time = t;
+	retval->demand = 0;
+	retval->next = NULL;
+	retval->prev = NULL;
+	return retval;
+}
+
 void queue_push(struct queue * q, int t, int x)
 {
 	/* Creates new node and sets data */
-	struct node * new_node = malloc(sizeof(struct node));
-	new_node->job = x;
-	new_node->time = t;
-	new_node->next = NULL;
-	new_node->prev = NULL;
+	struct node * new_node = make_node(q, t, x);
 
 	/* Sets as new head and tail if queue is empty */
 	if (q->size <= 0) {
@@ -61,6 +84,27 @@ void queue_push(struct queue * q, int t, int x)
 	}
 }
 
+/* Pushes a job onto the head of the queue, so it is popped before any job
+ * already waiting */
+void queue_push_front(struct queue * q, int t, int x)
+{
+	/* Creates new node and sets data */
+	struct node * new_node = make_node(q, t, x);
+
+	/* Sets as new head and tail if queue is empty */
+	if (q->size <= 0) {
+		q->head = new_node;
+		q->tail = new_node;
+		q->size = 1;
+	} else {
+		/* All other cases */
+		q->head->prev = new_node;
+		new_node->next = q->head;
+		q->head = new_node;
+		q->size++;
+	}
+}
+
 struct node * queue_pop(struct queue * q)
 {
 	/* Returns error if queue is already empty */
@@ -101,6 +145,33 @@ struct node * queue_peek(struct queue * q)
 	return retval;
 }
 
+/* Creates n spare nodes up front, so that pushing that many jobs allocates
+ * nothing */
+void queue_reserve(struct queue * q, int n)
+{
+	for (int i = 0; i < n; i++) {
+		struct node * spare = malloc(sizeof(struct node));
+		spare->next = q->spare;
+		q->spare = spare;
+	}
+}
+
+/* Gives a node popped from the queue back to it to be reused, in place of
+ * freeing it */
+void queue_recycle(struct queue * q, struct node * n)
+{
+	n->next = q->spare;
+	q->spare = n;
+}
+
+/* Empties the queue, keeping its nodes as spares to be reused */
+void queue_clear(struct queue * q)
+{
+	while (q->size > 0) {
+		queue_recycle(q, queue_pop(q));
+	}
+}
+
 bool queue_is_empty(struct queue * q)
 {
 	if (q->size == 0) {
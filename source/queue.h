@@ -5,6 +5,7 @@ struct node
 {
 	int job;
 	int time;
+	int demand;		// Service demand carried by the job, 0 if none
 	struct node * next;
 	struct node * prev;
 };
@@ -14,13 +15,18 @@ struct queue
 	struct node * head;
 	struct node * tail;
 	int size;
+	struct node * spare;	// Nodes kept for reuse, linked by next
 };
 
 struct queue * init_queue();
 void kill_queue(struct queue * q);
 void queue_push(struct queue * q, int t, int x);
+void queue_push_front(struct queue * q, int t, int x);
 struct node * queue_pop(struct queue * q);
 struct node * queue_peek(struct queue * q);
+void queue_reserve(struct queue * q, int n);
+void queue_recycle(struct queue * q, struct node * n);
+void queue_clear(struct queue * q);
 bool queue_is_empty(struct queue * q);
 void print_queue(struct queue * q);
 
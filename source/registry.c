@@ -0,0 +1,158 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <time.h>
+#include "min_heap.h"
+#include "registry.h"
+
+#define INIT_CAPACITY 16
+
+/* Function to create and initialize a new registry with no types */
+struct registry * init_registry(bool profile)
+{
+	struct registry * reg = malloc(sizeof(struct registry));
+	reg->handlers = malloc(sizeof(event_handler) * INIT_CAPACITY);
+	reg->ctxs = malloc(sizeof(void *) * INIT_CAPACITY);
+	reg->names = malloc(sizeof(char *) * INIT_CAPACITY);
+	reg->counts = malloc(sizeof(long long) * INIT_CAPACITY);
+	reg->nsecs = malloc(sizeof(long long) * INIT_CAPACITY);
+	reg->size = 0;
+	reg->capacity = INIT_CAPACITY;
+	reg->profile = profile;
+
+	for (int i = 0; i < reg->capacity; i++) {
+		*(reg->handlers + i) = NULL;
+	}
+
+	return reg;
+}
+
+/* Function to free a registry */
+void kill_registry(struct registry * reg)
+{
+	free(reg->handlers);
+	free(reg->ctxs);
+	free(reg->names);
+	free(reg->counts);
+	free(reg->nsecs);
+	free(reg);
+}
+
+/* Function used to grow the tables until type fits */
+static void grow_registry(struct registry * reg, int type)
+{
+	int new_capacity = reg->capacity;
+	while (new_capacity <= type) {
+		new_capacity *= 2;
+	}
+
+	reg->handlers = realloc(reg->handlers,
+			sizeof(event_handler) * new_capacity);
+	reg->ctxs = realloc(reg->ctxs, sizeof(void *) * new_capacity);
+	reg->names = realloc(reg->names, sizeof(char *) * new_capacity);
+	reg->counts = realloc(reg->counts, sizeof(long long) * new_capacity);
+	reg->nsecs = realloc(reg->nsecs, sizeof(long long) * new_capacity);
+
+	for (int i = reg->capacity; i < new_capacity; i++) {
+		*(reg->handlers + i) = NULL;
+	}
+	reg->capacity = new_capacity;
+}
+
+/* Registers handler for events of the given type, called with ctx. Used for the
+ * types with fixed numbers that the simulation itself defines.
+ */
+void registry_add(struct registry * reg, int type, const char * name,
+		event_handler handler, void * ctx)
+{
+	if (type < 0) {
+		fprintf(stderr, "Error: Event type %d is negative\n", type);
+		exit(1);
+	} else if (type < reg->size && *(reg->handlers + type) != NULL) {
+		fprintf(stderr, "Error: Event type %d registered twice\n", type);
+		exit(1);
+	}
+
+	if (type >= reg->capacity) {
+		grow_registry(reg, type);
+	}
+	for (int i = reg->size; i < type; i++) {
+		*(reg->handlers + i) = NULL;
+	}
+
+	*(reg->handlers + type) = handler;
+	*(reg->ctxs + type) = ctx;
+	*(reg->names + type) = name;
+	*(reg->counts + type) = 0;
+	*(reg->nsecs + type) = 0;
+	if (type >= reg->size) {
+		reg->size = type + 1;
+	}
+}
+
+/* Registers handler for a new kind of event and returns the type number given
+ * to it. This lets models add event kinds without knowing which numbers are
+ * taken.
+ */
+int registry_new_type(struct registry * reg, const char * name,
+		event_handler handler, void * ctx)
+{
+	int type = reg->size;
+	registry_add(reg, type, name, handler, ctx);
+	return type;
+}
+
+/* Calls the handler registered for the type of e and returns what it returns */
+int registry_dispatch(struct registry * reg, struct event * e)
+{
+	int type = e->type;
+	if (type < 0 || type >= reg->size || *(reg->handlers + type) == NULL) {
+		fprintf(stderr, "unknown job type code\n");
+		exit(1);
+	}
+
+	*(reg->counts + type) += 1;
+	if (!reg->profile) {
+		return (*(reg->handlers + type))(e, *(reg->ctxs + type));
+	}
+
+	struct timespec start;
+	struct timespec end;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	int retval = (*(reg->handlers + type))(e, *(reg->ctxs + type));
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	*(reg->nsecs + type) += (end.tv_sec - start.tv_sec) * 1000000000LL
+			+ (end.tv_nsec - start.tv_nsec);
+
+	return retval;
+}
+
+/* Starts the counts and handling times of every type over */
+void registry_reset_stats(struct registry * reg)
+{
+	for (int i = 0; i < reg->size; i++) {
+		*(reg->counts + i) = 0;
+		*(reg->nsecs + i) = 0;
+	}
+}
+
+/* Prints how many events of each type were handled, and how long they took to
+ * handle if profiling, to stats file */
+void record_registry_stats(struct registry * reg, FILE * stats_file)
+{
+	for (int i = 0; i < reg->size; i++) {
+		if (*(reg->handlers + i) == NULL) {
+			continue;
+		}
+
+		long long count = *(reg->counts + i);
+		if (reg->profile && count > 0) {
+			fprintf(stats_file, "%s events = %lld, avg handling time = %lf ns\n",
+					*(reg->names + i), count,
+					*(reg->nsecs + i) / (double) count);
+		} else {
+			fprintf(stats_file, "%s events = %lld\n",
+					*(reg->names + i), count);
+		}
+	}
+}
@@ -0,0 +1,39 @@
+#ifndef REGISTRY_H
+#define REGISTRY_H
+
+/* Values returned by event handlers */
+#define HANDLER_CONTINUE 0	// Keep running the simulation
+#define HANDLER_STOP 1		// The simulation is over
+#define HANDLER_PASSIVE 2	// Keep running, the model was left alone
+
+/* Function called to handle an event of the type it is registered for. ctx is
+ * the context pointer given when the handler was registered.
+ */
+typedef int (*event_handler)(struct event * e, void * ctx);
+
+/* Table mapping event types to their handlers. Event types index the arrays
+ * directly, so dispatching an event is one indexed call.
+ */
+struct registry
+{
+	event_handler * handlers;	// Handler of each type, NULL if none
+	void ** ctxs;			// Context pointer of each type
+	const char ** names;		// Name of each type, for stats
+	long long * counts;		// Events dispatched of each type
+	long long * nsecs;		// Time spent handling each type
+	int size;			// One past the largest registered type
+	int capacity;
+	bool profile;			// Time every dispatch if true
+};
+
+struct registry * init_registry(bool profile);
+void kill_registry(struct registry * reg);
+void registry_add(struct registry * reg, int type, const char * name,
+		event_handler handler, void * ctx);
+int registry_new_type(struct registry * reg, const char * name,
+		event_handler handler, void * ctx);
+int registry_dispatch(struct registry * reg, struct event * e);
+void registry_reset_stats(struct registry * reg);
+void record_registry_stats(struct registry * reg, FILE * stats_file);
+
+#endif /* not defined REGISTRY_H */
@@ -0,0 +1,1130 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include "config.h"
+#include "min_heap.h"
+#include "event_set.h"
+#include "tourney.h"
+#include "queue.h"
+#include "trace.h"
+#include "job_table.h"
+#include "station.h"
+#include "registry.h"
+#include "metrics.h"
+#include "sim.h"
+
+/* Handlers of each event type of the model */
+static int sim_fin(struct event * e, void * ctx);
+static int job_arrives(struct event * e, void * ctx);
+static int cpu_finished(struct event * e, void * ctx);
+static int disk1_finished(struct event * e, void * ctx);
+static int disk2_finished(struct event * e, void * ctx);
+static int sample(struct event * e, void * ctx);
+static int branch(struct event * e, void * ctx);
+
+/* Calcs when a job finishes at a server, using its service demand if it has one */
+static int calc_service_time(struct config * conf, int t, int x, int cls,
+		int demand);
+/* Calcs whether or not job of class cls should quit, given configuarion */
+static bool quit_job(struct config * conf, int cls);
+/* Calcs when a job of a closed system that starts thinking at t comes back */
+static int calc_think_time(struct config * conf, int t);
+/* Sends a job of a closed system that is done back to thinking */
+static void think_job(struct sim * sim, int job, int t);
+/* Pushes an event from the given source and returns its key */
+static event_key_t schedule(struct sim * sim, int source, int t, int job, int x);
+/* Returns the event source of a server of a station */
+static int server_source(struct sim * sim, struct station * st, int server);
+/* Adds the derivatives of a time drawn by calc_job_time to a vector */
+static void ipa_draw(struct config * conf, double * d, int x, int cls, int s);
+/* Returns the class a trace record's job is given */
+static int trace_class(struct sim * sim, const struct trace_record * rec);
+/* Sends job to a station, pushing its finish event if it is served right away */
+static void send_job(struct sim * sim, struct station * st, int x, int job,
+		int demand, int t);
+/* Stops the job at a server so a job of a higher class can take it */
+static void preempt_job(struct sim * sim, struct station * st, int server,
+		int t);
+/* Starts the next waiting job on a server that just became idle */
+static void next_job(struct sim * sim, struct station * st, int x, int server,
+		int t);
+/* Adds the current queue sizes to the statistics */
+static void sample_stats(struct sim * sim);
+/* Prints statistics to stats file */
+static void record_stats(struct statistics * stats, struct station * cpu,
+		struct station * disk1, struct station * disk2,
+		FILE * stats_file);
+/* Prints the derivatives found by IPA to stats file */
+static void record_ipa_stats(struct job_stats * js, FILE * stats_file);
+/* Prints per server statistics of a station to stats file */
+static void record_server_stats(struct station * st, int sim_tot_t,
+		FILE * stats_file);
+/* Creates stats, and inits values properly, returns pointer to stats struct */
+static struct statistics * init_stats(struct config * conf);
+/* Sets every value of stats back to its initial value */
+static void clear_stats(struct statistics * stats, struct config * conf);
+/* Pushes the end of the simulation and the first arrivals, with population
+ * thinking jobs if the system is closed */
+static void start_sim(struct sim * sim, int population);
+/* Empties the simulation and starts it over from INIT_TIME with population
+ * jobs, reusing everything already allocated */
+static void rewind_sim(struct sim * sim, int population);
+/* Copies progress and running statistics into the live metrics segment */
+static void publish_metrics(struct sim * sim, bool finished);
+/* Returns wall clock time in seconds */
+static double wall_now();
+
+/* Creates a simulation of the model described by conf, with its handlers
+ * registered and its first events pushed, ready to be run.
+ */
+struct sim * init_sim(struct config * conf, FILE * log_file)
+{
+	struct sim * sim = malloc(sizeof(struct sim));
+	sim->conf = conf;
+	sim->stats = init_stats(conf);
+	sim->cpu = init_station("CPU", conf->cpu_servers, conf->classes,
+			conf->ipa);
+	sim->disk1 = init_station("Disk1", conf->disk1_servers, conf->classes,
+			conf->ipa);
+	sim->disk2 = init_station("Disk2", conf->disk2_servers, conf->classes,
+			conf->ipa);
+	sim->to_do = NULL;
+	sim->fast = NULL;
+	if (sim_fits_tourney(conf)) {
+		int streams = conf->population > 0 ? conf->population
+				: conf->classes;
+		sim->fast = init_tourney(SOURCE_ARRIVALS + streams
+				+ conf->cpu_servers + conf->disk1_servers
+				+ conf->disk2_servers);
+	} else {
+		sim->to_do = init_event_set(conf->event_mem_limit);
+	}
+
+	/* Servers keep the keys of their finish events to tell them from stale
+	 * ones, so the keys have to follow the events when renumbered */
+	struct key_watch * kw = sim->fast != NULL ? &sim->fast->watch
+			: &sim->to_do->watch;
+	station_watch(sim->cpu, kw);
+	station_watch(sim->disk1, kw);
+	station_watch(sim->disk2, kw);
+	sim->jobs = init_job_table(conf->classes, conf->ipa);
+	sim->reg = init_registry(conf->profile_handlers);
+	sim->trace = NULL;
+	sim->arr_rec = NULL;
+	sim->log_file = log_file;
+	sim->t = conf->init_time;
+	sim->job_count = conf->population > 0 ? conf->population
+			: conf->classes;
+	sim->events = 0;
+	sim->metrics = NULL;
+	sim->wall_start = wall_now();
+	sim->wall_last = sim->wall_start;
+	sim->events_last = 0;
+	sim->paused = false;
+	sim->sweep_x = NULL;
+	sim->sweep_r = NULL;
+	if (conf->pop_sweep) {
+		sim->sweep_x = malloc(sizeof(double) * conf->population);
+		sim->sweep_r = malloc(sizeof(double) * conf->population);
+	}
+	if (conf->metrics_shm[0] != '\0') {
+		sim->metrics = init_metrics(conf->metrics_shm);
+		publish_metrics(sim, false);
+	}
+	srand(conf->seed);
+
+	registry_add(sim->reg, SIM_FIN, "Simulation finished", sim_fin, sim);
+	registry_add(sim->reg, JOB_ARRIVES, "Job arrives", job_arrives, sim);
+	registry_add(sim->reg, CPU_FINISHED, "CPU finished", cpu_finished, sim);
+	registry_add(sim->reg, DISK1_FINISHED, "Disk1 finished",
+			disk1_finished, sim);
+	registry_add(sim->reg, DISK2_FINISHED, "Disk2 finished",
+			disk2_finished, sim);
+
+	/* Arrivals are replayed from a trace if one is configured, otherwise
+	 * each class has its own stream drawn from its ARRIVE_MIN and
+	 * ARRIVE_MAX */
+	if (conf->trace_file[0] != '\0') {
+		sim->trace = init_trace(conf->trace_file, conf->init_time);
+	}
+
+	/* The jobs of a closed system are all made at the start, with room
+	 * for every one of them in each queue */
+	if (conf->population > 0) {
+		station_reserve(sim->cpu, conf->population);
+		station_reserve(sim->disk1, conf->population);
+		station_reserve(sim->disk2, conf->population);
+	}
+
+	/* START SIMULATION */
+	start_sim(sim, conf->population);
+
+	/* Periodic sampling is its own kind of event, registered like any
+	 * event a model might add */
+	struct event * new_e;
+	if (conf->sample_interval > 0) {
+		int type = registry_new_type(sim->reg, "Sample", sample, sim);
+		new_e = create_event(conf->init_time + conf->sample_interval,
+				-1, type);
+		event_set_push(sim->to_do, new_e);
+	}
+
+	/* So is the point where the simulation branches */
+	if (conf->num_branches > 0) {
+		int type = registry_new_type(sim->reg, "Branch", branch, sim);
+		new_e = create_event(conf->branch_time, -1, type);
+		event_set_push(sim->to_do, new_e);
+	}
+
+	return sim;
+}
+
+/* Function to free a simulation */
+void kill_sim(struct sim * sim)
+{
+	free(sim->stats);
+	kill_station(sim->cpu);
+	kill_station(sim->disk1);
+	kill_station(sim->disk2);
+	if (sim->to_do != NULL) {
+		kill_event_set(sim->to_do);
+	}
+	if (sim->fast != NULL) {
+		kill_tourney(sim->fast);
+	}
+	kill_job_table(sim->jobs);
+	kill_registry(sim->reg);
+	if (sim->trace != NULL) {
+		kill_trace(sim->trace);
+	}
+	if (sim->metrics != NULL) {
+		kill_metrics(sim->metrics);
+	}
+	free(sim->sweep_x);
+	free(sim->sweep_r);
+	free(sim);
+}
+
+/* Runs the simulation until a handler stops it or no events are left. Each
+ * event is handed to the handler registered for its type. If live metrics are
+ * on they are updated every METRICS_PERIOD events and once more at the end.
+ * A simulation paused to be branched can be run again to carry on.
+ */
+void run_sim(struct sim * sim)
+{
+	struct event * curr_e;	// Current event (changes with each pass)
+	int stop;		// What the handler returned
+
+	sim->paused = false;
+	while (sim->fast != NULL ? !tourney_is_empty(sim->fast)
+			: !event_set_is_empty(sim->to_do)) {
+		/* Events popped from the tournament stay in it, the rest
+		 * are freed once handled */
+		if (sim->fast != NULL) {
+			curr_e = tourney_pop(sim->fast);
+		} else {
+			curr_e = event_set_pop(sim->to_do);
+		}
+		sim->t = curr_e->time;
+		stop = registry_dispatch(sim->reg, curr_e);
+		if (sim->fast == NULL) {
+			free(curr_e);
+		}
+		sim->events++;
+
+		if (stop == HANDLER_STOP) {
+			break;
+		}
+
+		/* Only events of the model count, so that samples and stale
+		 * finish events leave the results as they are */
+		if (stop == HANDLER_CONTINUE) {
+			sample_stats(sim);
+			sim->job_count++;
+		}
+
+		if (sim->metrics != NULL && sim->events % METRICS_PERIOD == 0) {
+			publish_metrics(sim, false);
+		}
+	}
+
+	if (sim->metrics != NULL && !sim->paused) {
+		publish_metrics(sim, true);
+	}
+}
+
+/* Runs a closed system once for each population from 1 to POPULATION, every
+ * run from INIT_TIME with the same SEED, and keeps the job throughput and
+ * response time of each. The state made for POPULATION jobs is cleared and
+ * reused by every run, and the statistics of the last run, with all POPULATION
+ * jobs, are left to be recorded as a run of its own.
+ */
+void sweep_sim(struct sim * sim)
+{
+	for (int n = 1; n <= sim->conf->population; n++) {
+		rewind_sim(sim, n);
+		fprintf(sim->log_file, "Population %d\n", n);
+		run_sim(sim);
+
+		struct job_stats * js = &sim->jobs->all;
+		*(sim->sweep_x + n - 1) = js->done_jobs * 100
+				/ (double) sim->stats->sim_tot_t;
+		*(sim->sweep_r + n - 1) = js->done_jobs > 0
+				? js->tot_sojourn_t / (double) js->done_jobs : 0;
+	}
+}
+
+/* Carries on a simulation paused at BRANCH_TIME as the given branch, 0 being
+ * the unchanged simulation, which stays with the process that forked the
+ * others. Each process has its own copy of everything the simulation holds, so
+ * it only has to switch over to the config and log file of its branch and
+ * start its statistics over from the branch point. The random number stream is
+ * also copied, so branches draw the same numbers unless their SEED differs.
+ */
+void branch_sim(struct sim * sim, struct config * conf, FILE * log_file,
+		int branch)
+{
+	if (conf->seed != sim->conf->seed) {
+		srand(conf->seed);
+	}
+	sim->conf = conf;
+	sim->log_file = log_file;
+
+	free(sim->stats);
+	sim->stats = init_stats(conf);
+	sim->stats->sim_tot_t = conf->fin_time - sim->t;
+	station_reset_stats(sim->cpu, sim->t);
+	station_reset_stats(sim->disk1, sim->t);
+	station_reset_stats(sim->disk2, sim->t);
+	job_table_reset_stats(sim->jobs);
+	event_set_fork(sim->to_do);
+
+	/* The live metrics segment stays with the unchanged simulation */
+	if (branch > 0 && sim->metrics != NULL) {
+		kill_metrics(sim->metrics);
+		sim->metrics = NULL;
+	}
+}
+
+/* Prints the statistics of a finished simulation to stats file */
+void record_sim(struct sim * sim, FILE * stats_file)
+{
+	record_stats(sim->stats, sim->cpu, sim->disk1, sim->disk2, stats_file);
+	fprintf(stats_file, "\n");
+	record_job_stats(sim->jobs, stats_file);
+	if (sim->conf->population > 0) {
+		fprintf(stats_file, "Job throughput = %lf per 100 units of time\n",
+				sim->jobs->all.done_jobs * 100
+				/ (double) sim->stats->sim_tot_t);
+	}
+	if (sim->sweep_x != NULL) {
+		fprintf(stats_file, "\nSimulated sweep (closed network, think time %d to %d)\n",
+				sim->conf->think_min, sim->conf->think_max);
+		for (int n = 1; n <= sim->conf->population; n++) {
+			fprintf(stats_file, "N = %d: throughput = %lf per 100 units of time, response time = %lf%s\n",
+					n, *(sim->sweep_x + n - 1),
+					*(sim->sweep_r + n - 1),
+					n == sim->conf->population
+					? " (POPULATION)" : "");
+		}
+	}
+	if (sim->conf->ipa) {
+		record_ipa_stats(&sim->jobs->all, stats_file);
+	}
+	fprintf(stats_file, "\n");
+	record_registry_stats(sim->reg, stats_file);
+	if (sim->to_do != NULL) {
+		record_event_set_stats(sim->to_do, stats_file);
+	}
+}
+
+/* Returns whether a simulation of conf can keep its events in a tournament. It
+ * can when every pending event comes from a source with at most one pending at
+ * a time: the end of the simulation, the arrival stream of each class and each
+ * server. Periodic samples, branches and a memory limit on events all need the
+ * event set, and so does preemption, whose stale finish events stay pending
+ * next to new ones from the same server.
+ */
+bool sim_fits_tourney(struct config * conf)
+{
+	return conf->fast_sched && conf->event_mem_limit == 0
+			&& conf->sample_interval == 0
+			&& conf->num_branches == 0 && !conf->preempt;
+}
+
+/* Current event is the simulation finished event, which ends the simulation */
+static int sim_fin(struct event * e, void * ctx)
+{
+	struct sim * sim = ctx;
+
+	fprintf(sim->log_file, "%d: Simulation Finished\n", e->time);
+	return HANDLER_STOP;
+}
+
+/* Current event is a job arrival event, so it must now be sent to the cpu or
+ * quit. Determining next job arrival is also handled here so that jobs arrive
+ * at more regular intervals.
+ */
+static int job_arrives(struct event * e, void * ctx)
+{
+	struct sim * sim = ctx;
+	struct job_table * jobs = sim->jobs;
+	int t = e->time;
+	int job = e->job;
+	int cls = *(jobs->cls + job);
+	int demand;
+	int fin_t;
+
+	demand = sim->trace == NULL ? 0 : sim->arr_rec->demand;
+	if (sim->trace == NULL && sim->conf->classes == 1) {
+		fprintf(sim->log_file, "%d: Job%lld arrives\n", t,
+				*(jobs->id + job));
+	} else {
+		fprintf(sim->log_file, "%d: Job%lld arrives (class %d)\n", t,
+				*(jobs->id + job), cls);
+	}
+
+	/* Determing next job arrival and add the event to heap. Without a
+	 * trace the next arrival is of the same class, so each class arrives
+	 * at its own rate. A trace that has run dry has no next arrival. The
+	 * arriving job takes its job table slot now. Jobs of a closed system
+	 * have no next arrival, as each arrives again once it is done and has
+	 * thought */
+	if (sim->conf->population == 0 && sim->trace == NULL) {
+		fin_t = calc_job_time(sim->conf, t, JOB_ARRIVES, cls);
+		int next = job_alloc(jobs, sim->job_count + 1, cls, fin_t);
+		schedule(sim, SOURCE_ARRIVALS + cls, fin_t, next, JOB_ARRIVES);
+
+		/* The next arrival time moves with this one */
+		if (jobs->d_t != NULL) {
+			double * d = jobs->d_arrive_t + next * IPA_PARAMS;
+			memcpy(d, jobs->d_arrive_t + job * IPA_PARAMS,
+					sizeof(double) * IPA_PARAMS);
+			ipa_draw(sim->conf, d, JOB_ARRIVES, cls, fin_t - t);
+			memcpy(jobs->d_t + next * IPA_PARAMS, d,
+					sizeof(double) * IPA_PARAMS);
+		}
+	} else if (sim->trace != NULL && !trace_is_empty(sim->trace)) {
+		sim->arr_rec = trace_pop(sim->trace);
+		fin_t = sim->arr_rec->time;
+		int next_cls = trace_class(sim, sim->arr_rec);
+		schedule(sim, SOURCE_ARRIVALS + next_cls, fin_t,
+				job_alloc(jobs, sim->job_count + 1, next_cls,
+				fin_t), JOB_ARRIVES);
+	}
+
+	/* If a cpu is idle, job can be handled immediately. If not, add to cpu
+	 * queue and handle it later */
+	send_job(sim, sim->cpu, CPU_FINISHED, job, demand, t);
+
+	return HANDLER_CONTINUE;
+}
+
+/* Current event is a cpu finished event, so it must be sent to a disk, or
+ * abandoned if the job is finished (Whether it is finished or not is
+ * determined by quit_prob)
+ */
+static int cpu_finished(struct event * e, void * ctx)
+{
+	struct sim * sim = ctx;
+	struct statistics * stats = sim->stats;
+	struct job_table * jobs = sim->jobs;
+	struct station * cpu = sim->cpu;
+	int t = e->time;
+	int job = e->job;
+
+	/* The finish event of a job that was preempted is stale, as the job
+	 * is either waiting again or has a new finish event */
+	int server = *(jobs->server + job);
+	if (server == -1 || *(cpu->fin_key + server) != e->key) {
+		return HANDLER_PASSIVE;
+	}
+	if (cpu->d_fin_t != NULL) {
+		memcpy(jobs->d_t + job * IPA_PARAMS,
+				cpu->d_fin_t + server * IPA_PARAMS,
+				sizeof(double) * IPA_PARAMS);
+	}
+
+	fprintf(sim->log_file, "%d: Job%lld finishes at CPU\n", t,
+			*(jobs->id + job));
+
+	int resp_t = t - *(cpu->arrive_t + server);
+	int work = station_finish(cpu, server, t);
+
+	/* Some stat handling */
+	*(jobs->visits + job) += 1;
+	*(jobs->service_t + job) += work;
+	stats->cpu_tot_resp_t += resp_t;
+	stats->cpu_comp_jobs++;
+	if (stats->cpu_max_resp_t < resp_t) {
+		stats->cpu_max_resp_t = resp_t;
+	}
+
+	/* Either quits job, or sends to disk1 or disk2 (Whichever has less
+	 * jobs per server, which is the one with less jobs when both have as
+	 * many servers)
+	 */
+	if (quit_job(sim->conf, *(jobs->cls + job))) {
+		if (sim->conf->population > 0) {
+			think_job(sim, job, t);
+		} else {
+			fprintf(sim->log_file, "%d: Job%lld quitting\n", t,
+					*(jobs->id + job));
+			job_release(jobs, job, t);
+		}
+	} else if (sim->disk1->size * sim->disk2->servers
+			< sim->disk2->size * sim->disk1->servers) {
+		send_job(sim, sim->disk1, DISK1_FINISHED, job, 0, t);
+	} else { // disk2 < disk1
+		send_job(sim, sim->disk2, DISK2_FINISHED, job, 0, t);
+	}
+
+	/* Starts the next waiting job on this cpu, now that it is finished
+	 * with the old job
+	 */
+	next_job(sim, cpu, CPU_FINISHED, server, t);
+
+	return HANDLER_CONTINUE;
+}
+
+/* Current event is a disk1 finished event, so it must be sent to the cpu */
+static int disk1_finished(struct event * e, void * ctx)
+{
+	struct sim * sim = ctx;
+	struct statistics * stats = sim->stats;
+	struct job_table * jobs = sim->jobs;
+	struct station * disk1 = sim->disk1;
+	int t = e->time;
+	int job = e->job;
+
+	/* The finish event of a job that was preempted is stale, as the job
+	 * is either waiting again or has a new finish event */
+	int server = *(jobs->server + job);
+	if (server == -1 || *(disk1->fin_key + server) != e->key) {
+		return HANDLER_PASSIVE;
+	}
+	if (disk1->d_fin_t != NULL) {
+		memcpy(jobs->d_t + job * IPA_PARAMS,
+				disk1->d_fin_t + server * IPA_PARAMS,
+				sizeof(double) * IPA_PARAMS);
+	}
+
+	fprintf(sim->log_file, "%d: Job%lld finishes at disk1\n", t,
+			*(jobs->id + job));
+
+	int resp_t = t - *(disk1->arrive_t + server);
+	int work = station_finish(disk1, server, t);
+
+	/* Some stat handling */
+	*(jobs->visits + job) += 1;
+	*(jobs->service_t + job) += work;
+	stats->d1_tot_resp_t += resp_t;
+	stats->d1_comp_jobs++;
+	if (stats->d1_max_resp_t < resp_t) {
+		stats->d1_max_resp_t = resp_t;
+	}
+
+	send_job(sim, sim->cpu, CPU_FINISHED, job, 0, t);
+
+	/* Starts the next waiting job on this disk1 server if it exists, now
+	 * that it is finished with the old job
+	 */
+	next_job(sim, disk1, DISK1_FINISHED, server, t);
+
+	return HANDLER_CONTINUE;
+}
+
+/* Current event is a disk2 finished event, so it must be sent to the cpu */
+static int disk2_finished(struct event * e, void * ctx)
+{
+	struct sim * sim = ctx;
+	struct statistics * stats = sim->stats;
+	struct job_table * jobs = sim->jobs;
+	struct station * disk2 = sim->disk2;
+	int t = e->time;
+	int job = e->job;
+
+	/* The finish event of a job that was preempted is stale, as the job
+	 * is either waiting again or has a new finish event */
+	int server = *(jobs->server + job);
+	if (server == -1 || *(disk2->fin_key + server) != e->key) {
+		return HANDLER_PASSIVE;
+	}
+	if (disk2->d_fin_t != NULL) {
+		memcpy(jobs->d_t + job * IPA_PARAMS,
+				disk2->d_fin_t + server * IPA_PARAMS,
+				sizeof(double) * IPA_PARAMS);
+	}
+
+	fprintf(sim->log_file, "%d: Job%lld finishes at disk2\n", t,
+			*(jobs->id + job));
+
+	int resp_t = t - *(disk2->arrive_t + server);
+	int work = station_finish(disk2, server, t);
+
+	/* Some stat handling */
+	*(jobs->visits + job) += 1;
+	*(jobs->service_t + job) += work;
+	stats->d2_tot_resp_t += resp_t;
+	stats->d2_comp_jobs++;
+	if (stats->d2_max_resp_t < resp_t) {
+		stats->d2_max_resp_t = resp_t;
+	}
+
+	send_job(sim, sim->cpu, CPU_FINISHED, job, 0, t);
+
+	/* Starts the next waiting job on this disk2 server if it exists, now
+	 * that it is finished with the old job
+	 */
+	next_job(sim, disk2, DISK2_FINISHED, server, t);
+
+	return HANDLER_CONTINUE;
+}
+
+/* Current event is a periodic sample, so the size of every queue is logged and
+ * the next sample is scheduled */
+static int sample(struct event * e, void * ctx)
+{
+	struct sim * sim = ctx;
+	int t = e->time;
+
+	fprintf(sim->log_file, "%d: Sample cpu %d, disk1 %d, disk2 %d, jobs in system %d\n",
+			t, sim->cpu->size, sim->disk1->size, sim->disk2->size,
+			sim->cpu->size + sim->disk1->size + sim->disk2->size);
+
+	event_set_push(sim->to_do, create_event(t + sim->conf->sample_interval,
+			-1, e->type));
+
+	return HANDLER_PASSIVE;
+}
+
+/* Current event is the branch point, so the simulation pauses to be branched */
+static int branch(struct event * e, void * ctx)
+{
+	struct sim * sim = ctx;
+
+	fprintf(sim->log_file, "%d: Simulation branches into %d scenarios\n",
+			e->time, sim->conf->num_branches + 1);
+	sim->paused = true;
+	return HANDLER_STOP;
+}
+
+/* Calcs when job time occurs given configuration, current time, job type and
+ * the class of the job */
+int calc_job_time(struct config * conf, int t, int x, int cls)
+{
+	struct class_config * c = &conf->cls[cls];
+	int fin_t= rand();
+
+	switch (x) {
+	case JOB_ARRIVES :
+		fin_t %= (c->arrive_max - c->arrive_min);
+		fin_t += (c->arrive_min + t);
+		break;
+	case CPU_FINISHED :
+		fin_t %= (c->cpu_max - c->cpu_min);
+		fin_t += (c->cpu_min + t);
+		break;
+	case DISK1_FINISHED :
+		fin_t %= (c->disk1_max - c->disk1_min);
+		fin_t += (c->disk2_min + t);
+		break;
+	case DISK2_FINISHED :
+		fin_t %= (c->disk2_max - c->disk2_min);
+		fin_t += (c->disk2_min + t);
+		break;
+	default :
+		fprintf(stderr, "Error: Invalid job code for calc_job_time\n");
+		exit(1);
+		break;
+	}
+
+	return fin_t;
+}
+
+/* Calcs when a job finishes at a server, using its service demand if it has one */
+static int calc_service_time(struct config * conf, int t, int x, int cls,
+		int demand)
+{
+	if (demand > 0) {
+		return t + demand;
+	}
+	return calc_job_time(conf, t, x, cls);
+}
+
+/* Adds to d the derivatives of a time s drawn by calc_job_time, of type x, for
+ * a job of class cls. A draw is lo + U (max - min), where U is uniform on
+ * [0, 1) and lo is min for every type but disk1, whose times start from
+ * DISK2_MIN. Holding U fixed, as IPA does, its derivative is 1 for lo, -U for
+ * min and U for max.
+ */
+static void ipa_draw(struct config * conf, double * d, int x, int cls, int s)
+{
+	struct class_config * c = &conf->cls[cls];
+	int lo, min, max;	// Parameters the time depends on
+	int lo_v, span;		// Value of lo and max - min
+
+	switch (x) {
+	case JOB_ARRIVES :
+		lo = min = IPA_ARRIVE_MIN;
+		max = IPA_ARRIVE_MAX;
+		lo_v = c->arrive_min;
+		span = c->arrive_max - c->arrive_min;
+		break;
+	case CPU_FINISHED :
+		lo = min = IPA_CPU_MIN;
+		max = IPA_CPU_MAX;
+		lo_v = c->cpu_min;
+		span = c->cpu_max - c->cpu_min;
+		break;
+	case DISK1_FINISHED :
+		lo = IPA_DISK2_MIN;
+		min = IPA_DISK1_MIN;
+		max = IPA_DISK1_MAX;
+		lo_v = c->disk2_min;
+		span = c->disk1_max - c->disk1_min;
+		break;
+	case DISK2_FINISHED :
+		lo = min = IPA_DISK2_MIN;
+		max = IPA_DISK2_MAX;
+		lo_v = c->disk2_min;
+		span = c->disk2_max - c->disk2_min;
+		break;
+	default :
+		fprintf(stderr, "Error: Invalid job code for ipa_draw\n");
+		exit(1);
+		break;
+	}
+
+	double u = (s - lo_v) / (double) span;
+	*(d + lo) += 1;
+	*(d + min) -= u;
+	*(d + max) += u;
+}
+
+/* Pushes an event for job, of type x, at time t, from the given source, onto
+ * the tournament if the simulation has one and otherwise onto the event set.
+ * Returns the key of the event.
+ */
+static event_key_t schedule(struct sim * sim, int source, int t, int job, int x)
+{
+	if (sim->fast != NULL) {
+		return tourney_push(sim->fast, source, t, job, x);
+	}
+	return event_set_push(sim->to_do, create_event(t, job, x));
+}
+
+/* Returns the event source of a server of a station. The servers of the cpu,
+ * disk1 and disk2 follow the arrival stream of each class, in that order */
+static int server_source(struct sim * sim, struct station * st, int server)
+{
+	int streams = sim->conf->population > 0 ? sim->conf->population
+			: sim->conf->classes;
+	int source = SOURCE_ARRIVALS + streams + server;
+	if (st != sim->cpu) {
+		source += sim->cpu->servers;
+	}
+	if (st == sim->disk2) {
+		source += sim->disk1->servers;
+	}
+	return source;
+}
+
+/* Calcs when a job of a closed system that starts thinking at time t is done
+ * thinking and arrives again */
+static int calc_think_time(struct config * conf, int t)
+{
+	int retval = rand();
+	retval %= (conf->think_max - conf->think_min);
+	retval += (conf->think_min + t);
+	return retval;
+}
+
+/* A job of a closed system that is done at time t has its statistics recorded
+ * and thinks before it arrives again, keeping its slot in the job table and
+ * its event source */
+static void think_job(struct sim * sim, int job, int t)
+{
+	int arrive_t = calc_think_time(sim->conf, t);
+
+	fprintf(sim->log_file, "%d: Job%lld done, thinking until %d\n", t,
+			*(sim->jobs->id + job), arrive_t);
+	job_recycle(sim->jobs, job, t, arrive_t);
+	schedule(sim, SOURCE_ARRIVALS + job, arrive_t, job, JOB_ARRIVES);
+}
+
+/* Calcs whether or not job of class cls should quit, given configuarion */
+static bool quit_job(struct config * conf, int cls)
+{
+	int x = rand() % 1000;
+
+	double temp = conf->cls[cls].quit_prob * 1000;
+	int quit_prob_i = (int) round(temp);
+	if (x < quit_prob_i) {
+		return true;
+	}
+	return false;
+}
+
+/* Returns the class a trace record's job is given. Classes past the last class
+ * in use are given the last, lowest priority, class */
+static int trace_class(struct sim * sim, const struct trace_record * rec)
+{
+	if (rec->job_class < 0 || rec->job_class >= sim->conf->classes) {
+		return sim->conf->classes - 1;
+	}
+	return rec->job_class;
+}
+
+/* Sends job to a station at time t. If one of its servers is idle the job
+ * starts there right away and its finish event, of type x, is pushed onto the
+ * heap. With preemption on, a job finding every server busy takes the server
+ * of a job of a lower class if there is one. Otherwise it waits in its class's
+ * queue at the station.
+ */
+static void send_job(struct sim * sim, struct station * st, int x, int job,
+		int demand, int t)
+{
+	int cls = *(sim->jobs->cls + job);
+
+	if (sim->conf->preempt) {
+		int victim = station_victim(st, cls, t);
+		if (victim != -1) {
+			preempt_job(sim, st, victim, t);
+		}
+	}
+
+	int server = station_arrive(st, job, cls, demand, t);
+	*(sim->jobs->server + job) = server;
+
+	if (server != -1) {
+		int fin_t = calc_service_time(sim->conf, t, x, cls, demand);
+		*(st->fin_t + server) = fin_t;
+		*(st->fin_key + server) = schedule(sim,
+				server_source(sim, st, server), fin_t, job, x);
+
+		/* Service starts as the job gets here */
+		if (st->d_fin_t != NULL) {
+			double * d = st->d_fin_t + server * IPA_PARAMS;
+			memcpy(d, sim->jobs->d_t + job * IPA_PARAMS,
+					sizeof(double) * IPA_PARAMS);
+			if (demand <= 0) {
+				ipa_draw(sim->conf, d, x, cls, fin_t - t);
+			}
+		}
+	}
+}
+
+/* Stops the job at server at time t and puts it back in its class's queue to
+ * resume later. The work it got so far counts as service, and its finish event
+ * is left on the heap to be ignored.
+ */
+static void preempt_job(struct sim * sim, struct station * st, int server,
+		int t)
+{
+	struct job_table * jobs = sim->jobs;
+	int job = *(st->job + server);
+
+	fprintf(sim->log_file, "%d: Job%lld preempted at %s\n", t,
+			*(jobs->id + job), st->name);
+
+	*(jobs->service_t + job) += station_preempt(st, server, t);
+	*(jobs->server + job) = -1;
+}
+
+/* Starts the next job waiting at a station on server, which became idle at
+ * time t, and pushes its finish event, of type x, onto the heap. Does nothing if
+ * no job is waiting.
+ */
+static void next_job(struct sim * sim, struct station * st, int x, int server,
+		int t)
+{
+	struct node * next = station_next(st, server, t);
+	if (next == NULL) {
+		return;
+	}
+
+	*(sim->jobs->server + next->job) = server;
+	int fin_t = calc_service_time(sim->conf, t, x, *(st->cls + server),
+			next->demand);
+	*(st->fin_t + server) = fin_t;
+	*(st->fin_key + server) = schedule(sim, server_source(sim, st, server),
+			fin_t, next->job, x);
+
+	/* The node goes back to the queue it came from to be reused */
+	struct queue * q = *(st->qs + *(st->cls + server));
+
+	/* Service starts as the last job on this server finishes, so its
+	 * derivatives carry on from that finish time */
+	if (st->d_fin_t != NULL && next->demand <= 0) {
+		ipa_draw(sim->conf, st->d_fin_t + server * IPA_PARAMS, x,
+				*(st->cls + server), fin_t - t);
+	}
+	queue_recycle(q, next);
+}
+
+/* Adds the current queue sizes to the statistics, done after every event */
+static void sample_stats(struct sim * sim)
+{
+	struct statistics * stats = sim->stats;
+
+	if (stats->cpu_max < sim->cpu->size) {
+		stats->cpu_max = sim->cpu->size;
+	}
+	stats->cpu_cumul_len += sim->cpu->size;
+	stats->cpu_num_lens ++;
+
+	if (stats->d1_max < sim->disk1->size) {
+		stats->d1_max = sim->disk1->size;
+	}
+	stats->d1_cumul_len += sim->disk1->size;
+	stats->d1_num_lens ++;
+
+	if (stats->d2_max < sim->disk2->size) {
+		stats->d2_max = sim->disk2->size;
+	}
+	stats->d2_cumul_len += sim->disk2->size;
+	stats->d2_num_lens ++;
+}
+
+/* Prints statistics to stats file */
+static void record_stats(struct statistics * stats, struct station * cpu,
+		struct station * disk1, struct station * disk2,
+		FILE * stats_file)
+{
+	fprintf(stats_file, "CPU avg queue size = %lf\n",
+			stats->cpu_cumul_len / (double) stats->cpu_num_lens);
+	fprintf(stats_file, "CPU max queue size = %d\n", stats->cpu_max);
+	fprintf(stats_file, "CPU utilization = %lf%%\n",
+			(station_tot_busy_t(cpu) * 100)
+			/ ((double) stats->sim_tot_t * cpu->servers));
+	record_server_stats(cpu, stats->sim_tot_t, stats_file);
+	fprintf(stats_file, "CPU avg response time = %lf\n",
+			stats->cpu_tot_resp_t / (double) stats->cpu_comp_jobs);
+	fprintf(stats_file, "CPU max response time = %d\n",
+			stats->cpu_max_resp_t);
+	fprintf(stats_file, "CPU throughput = %lf per 100 units of time\n",
+			(stats->cpu_comp_jobs * 100)
+			/ (double) stats->sim_tot_t);
+	fprintf(stats_file, "\n");
+
+	fprintf(stats_file, "Disk1 avg queue size = %lf\n",
+			stats->d1_cumul_len / (double) stats->d1_num_lens);
+	fprintf(stats_file, "Disk1 max queue size = %d\n", stats->d1_max);
+	fprintf(stats_file, "Disk1 utilization = %lf%%\n",
+			(station_tot_busy_t(disk1) * 100)
+			/ ((double) stats->sim_tot_t * disk1->servers));
+	record_server_stats(disk1, stats->sim_tot_t, stats_file);
+	fprintf(stats_file, "Disk1 avg response time = %lf\n",
+			stats->d1_tot_resp_t / (double) stats->d1_comp_jobs);
+	fprintf(stats_file, "Disk1 max response time = %d\n",
+			stats->d1_max_resp_t);
+	fprintf(stats_file, "Disk1 throughput = %lf per 100 units of time\n",
+			(stats->d1_comp_jobs * 100)
+			/ (double) stats->sim_tot_t);
+	fprintf(stats_file, "\n");
+
+	fprintf(stats_file, "Disk2 avg queue size = %lf\n",
+			stats->d2_cumul_len / (double) stats->d2_num_lens);
+	fprintf(stats_file, "Disk2 max queue size = %d\n", stats->d2_max);
+	fprintf(stats_file, "Disk2 utilization = %lf%%\n",
+			(station_tot_busy_t(disk2) * 100)
+			/ ((double) stats->sim_tot_t * disk2->servers));
+	record_server_stats(disk2, stats->sim_tot_t, stats_file);
+	fprintf(stats_file, "Disk2 avg response time = %lf\n",
+			stats->d2_tot_resp_t / (double) stats->d2_comp_jobs);
+	fprintf(stats_file, "Disk2 max response time = %d\n",
+			stats->d2_max_resp_t);
+	fprintf(stats_file, "Disk2 throughput = %lf per 100 units of time\n",
+			(stats->d2_comp_jobs * 100)
+			/ (double) stats->sim_tot_t);
+}
+
+/* Prints the derivative of the average time in system of a set of jobs with
+ * respect to each parameter to stats file */
+static void record_ipa_stats(struct job_stats * js, FILE * stats_file)
+{
+	const char * names[IPA_PARAMS] = {"ARRIVE_MIN", "ARRIVE_MAX",
+			"CPU_MIN", "CPU_MAX", "DISK1_MIN", "DISK1_MAX",
+			"DISK2_MIN", "DISK2_MAX"};
+
+	/* The derivatives are averages over done jobs, so there are none */
+	if (js->done_jobs == 0) {
+		fprintf(stats_file, "No jobs done, so no derivatives of time in system\n");
+		return;
+	}
+
+	for (int p = 0; p < IPA_PARAMS; p++) {
+		fprintf(stats_file, "d(Job avg time in system)/d(%s) = %lf\n",
+				names[p], js->d_sojourn_t[p]
+				/ (double) js->done_jobs);
+	}
+}
+
+/* Prints the utilization of each server of a station with more than one */
+static void record_server_stats(struct station * st, int sim_tot_t,
+		FILE * stats_file)
+{
+	if (st->servers == 1) {
+		return;
+	}
+
+	for (int i = 0; i < st->servers; i++) {
+		fprintf(stats_file, "%s server %d utilization = %lf%%\n",
+				st->name, i, (*(st->busy_t + i) * 100)
+				/ (double) sim_tot_t);
+	}
+}
+
+/* Pushes the end of the simulation and the first arrivals, with population
+ * thinking jobs if the system is closed */
+static void start_sim(struct sim * sim, int population)
+{
+	struct config * conf = sim->conf;
+	schedule(sim, SOURCE_FIN, conf->fin_time, -1, SIM_FIN);
+	if (population > 0) {
+		/* Every job of a closed system starts out thinking, and is its
+		 * own arrival stream */
+		for (int k = 0; k < population; k++) {
+			int arrive_t = calc_think_time(conf, conf->init_time);
+			int job = job_alloc(sim->jobs, k + 1, 0, arrive_t);
+			schedule(sim, SOURCE_ARRIVALS + job, arrive_t, job,
+					JOB_ARRIVES);
+		}
+	} else if (sim->trace == NULL) {
+		for (int k = 0; k < conf->classes; k++) {
+			schedule(sim, SOURCE_ARRIVALS + k, conf->init_time,
+					job_alloc(sim->jobs, k + 1, k,
+					conf->init_time), JOB_ARRIVES);
+		}
+	} else if (!trace_is_empty(sim->trace)) {
+		sim->arr_rec = trace_pop(sim->trace);
+		int cls = trace_class(sim, sim->arr_rec);
+		schedule(sim, SOURCE_ARRIVALS + cls, sim->arr_rec->time,
+				job_alloc(sim->jobs, 1, cls,
+				sim->arr_rec->time), JOB_ARRIVES);
+	}
+}
+
+/* Empties the simulation and starts it over from INIT_TIME with population
+ * jobs, reusing everything already allocated. Only a closed system with no
+ * samples or branches is started over, so its only events are its own.
+ */
+static void rewind_sim(struct sim * sim, int population)
+{
+	if (sim->fast != NULL) {
+		tourney_clear(sim->fast);
+	} else {
+		while (!event_set_is_empty(sim->to_do)) {
+			free(event_set_pop(sim->to_do));
+		}
+	}
+	station_clear(sim->cpu);
+	station_clear(sim->disk1);
+	station_clear(sim->disk2);
+	job_table_clear(sim->jobs);
+	registry_reset_stats(sim->reg);
+	clear_stats(sim->stats, sim->conf);
+	sim->t = sim->conf->init_time;
+	sim->job_count = population;
+	sim->events = 0;
+
+	srand(sim->conf->seed);
+	start_sim(sim, population);
+}
+
+/* Creates stats, and inits values properly, returns pointer to stats struct */
+static struct statistics * init_stats(struct config * conf)
+{
+	struct statistics * stats = malloc(sizeof(struct statistics));
+	clear_stats(stats, conf);
+
+	return stats;
+}
+
+/* Sets every value of stats back to its initial value */
+static void clear_stats(struct statistics * stats, struct config * conf)
+{
+	stats->cpu_max = 0;
+	stats->d1_max = 0;
+	stats->d2_max = 0;
+	stats->cpu_cumul_len = 0;
+	stats->d1_cumul_len = 0;
+	stats->d2_cumul_len = 0;
+	stats->cpu_num_lens = 0;
+	stats->d1_num_lens = 0;
+	stats->d2_num_lens = 0;
+	stats->sim_tot_t = conf->fin_time - conf->init_time;
+	stats->cpu_tot_resp_t = 0;
+	stats->d1_tot_resp_t = 0;
+	stats->d2_tot_resp_t = 0;
+	stats->cpu_max_resp_t = 0;
+	stats->d1_max_resp_t = 0;
+	stats->d2_max_resp_t = 0;
+	stats->cpu_comp_jobs = 0;
+	stats->d1_comp_jobs = 0;
+	stats->d2_comp_jobs = 0;
+}
+
+/* Copies progress and running statistics into the live metrics segment. Rates
+ * and averages cover everything from the start of the simulation up to now,
+ * except events per second, which covers the time since the last update.
+ */
+static void publish_metrics(struct sim * sim, bool finished)
+{
+	struct statistics * stats = sim->stats;
+	double now = wall_now();
+	double elapsed = sim->t - sim->conf->init_time;
+	if (elapsed <= 0) {
+		elapsed = 1;
+	}
+
+	struct metrics_snapshot * snap = metrics_write_begin(sim->metrics);
+	snap->pid = getpid();
+	snap->finished = finished;
+	snap->init_time = sim->conf->init_time;
+	snap->fin_time = sim->conf->fin_time;
+	snap->time = sim->t;
+	snap->events = sim->events;
+	if (now > sim->wall_last) {
+		snap->events_per_sec = (sim->events - sim->events_last)
+				/ (now - sim->wall_last);
+	}
+	snap->wall_sec = now - sim->wall_start;
+	snap->cpu_size = sim->cpu->size;
+	snap->d1_size = sim->disk1->size;
+	snap->d2_size = sim->disk2->size;
+	snap->jobs_in_system = sim->cpu->size + sim->disk1->size
+			+ sim->disk2->size;
+	snap->jobs_done = sim->jobs->all.done_jobs;
+	snap->cpu_util = station_tot_busy_t(sim->cpu)
+			/ (elapsed * sim->cpu->servers);
+	snap->d1_util = station_tot_busy_t(sim->disk1)
+			/ (elapsed * sim->disk1->servers);
+	snap->d2_util = station_tot_busy_t(sim->disk2)
+			/ (elapsed * sim->disk2->servers);
+	snap->cpu_avg_resp_t = stats->cpu_tot_resp_t
+			/ (double) stats->cpu_comp_jobs;
+	snap->d1_avg_resp_t = stats->d1_tot_resp_t
+			/ (double) stats->d1_comp_jobs;
+	snap->d2_avg_resp_t = stats->d2_tot_resp_t
+			/ (double) stats->d2_comp_jobs;
+	snap->avg_sojourn_t = sim->jobs->all.tot_sojourn_t
+			/ (double) sim->jobs->all.done_jobs;
+	metrics_write_end(sim->metrics);
+
+	sim->wall_last = now;
+	sim->events_last = sim->events;
+}
+
+/* Returns wall clock time in seconds */
+static double wall_now()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
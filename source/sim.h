@@ -0,0 +1,85 @@
+#ifndef SIM_H
+#define SIM_H
+
+/* These definitions are the event types of the cpu/disk model. Each is
+ * registered with its handler in the sim's registry, and further types can be
+ * added with registry_new_type.
+ */
+#define SIM_FIN 0
+#define JOB_ARRIVES 1
+#define CPU_FINISHED 2
+#define DISK1_FINISHED 3
+#define DISK2_FINISHED 4
+
+/* Sources of events when they are kept in a tournament. The arrival stream of
+ * class k is source SOURCE_ARRIVALS + k, followed by the servers.
+ */
+#define SOURCE_FIN 0
+#define SOURCE_ARRIVALS 1
+
+/* Structure to hold statistic values. */
+struct statistics
+{
+	int cpu_max;			// Largest size reached by cpu queue
+	int d1_max;			// Largest size reached by disk1 queue
+	int d2_max;			// Largest size reached by disk2 queue
+	long long cpu_cumul_len;	// Sum of all lengths of cpu queue
+	long long d1_cumul_len;		// Sum of all lengths of disk1 queue
+	long long d2_cumul_len;		// Sum of all lengths of disk2 queue
+	long long cpu_num_lens;		// Number of lengths summed for cpu queue
+	long long d1_num_lens;		// Number of lengths summed for disk1 queue
+	long long d2_num_lens;		// Number of lengths summed for disk2 queue
+	int sim_tot_t;			// Total time of simulation
+	long long cpu_tot_resp_t;	// Total response time of cpu
+	long long d1_tot_resp_t;	// Total response time of disk1
+	long long d2_tot_resp_t;	// Total response time of disk2
+	int cpu_max_resp_t;		// Maximum response time from cpu
+	int d1_max_resp_t;		// Maximum response time from disk1
+	int d2_max_resp_t;		// Maximum response time from disk2
+	long long cpu_comp_jobs;	// Total number of completed jobs by cpu
+	long long d1_comp_jobs;		// Total number of completed jobs by disk1
+	long long d2_comp_jobs;		// Total number of completed jobs by disk2
+};
+
+/* Everything making up one running simulation. The handlers of the model's
+ * event types are registered with the sim as their context pointer.
+ */
+struct sim
+{
+	struct config * conf;
+	struct statistics * stats;
+	struct station * cpu;
+	struct station * disk1;
+	struct station * disk2;
+	struct event_set * to_do;	// Pending events, NULL if fast is used
+	struct tourney * fast;		// Pending events by source, if the
+					// model fits, else NULL
+	struct job_table * jobs;
+	struct registry * reg;		// Handlers of each event type
+	struct trace * trace;		// Arrival trace, NULL if none
+	const struct trace_record * arr_rec; // Record of next arrival
+	FILE * log_file;
+	int t;			// Time of the latest event
+	long long job_count;	// Total number of jobs created (excluding end)
+	long long events;	// Number of events handled
+	struct metrics * metrics; // Live metrics segment, NULL if none
+	double wall_start;	// Wall clock seconds when the sim was created
+	double wall_last;	// Wall clock seconds of the last metrics update
+	long long events_last;	// Events handled at the last metrics update
+	bool paused;		// Stopped at BRANCH_TIME, to be branched
+	double * sweep_x;	// Job throughput at each population swept,
+				// NULL if no sweep
+	double * sweep_r;	// Response time at each population swept
+};
+
+struct sim * init_sim(struct config * conf, FILE * log_file);
+void kill_sim(struct sim * sim);
+void run_sim(struct sim * sim);
+void sweep_sim(struct sim * sim);
+void record_sim(struct sim * sim, FILE * stats_file);
+bool sim_fits_tourney(struct config * conf);
+void branch_sim(struct sim * sim, struct config * conf, FILE * log_file,
+		int branch);
+int calc_job_time(struct config * conf, int t, int x, int cls);
+
+#endif /* not defined SIM_H */
@@ -0,0 +1,264 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include "config.h"
+#include "min_heap.h"
+#include "queue.h"
+#include "station.h"
+
+/* Function to create a station with the given number of idle servers and a
+ * queue for each job class. Each server also keeps the derivatives of its
+ * finish time if ipa is true.
+ */
+struct station * init_station(const char * name, int servers, int classes,
+		bool ipa)
+{
+	struct station * st = malloc(sizeof(struct station));
+	st->name = name;
+	st->qs = malloc(sizeof(struct queue *) * classes);
+	st->classes = classes;
+	st->servers = servers;
+	st->words = (servers + 63) / 64;
+	st->idle = malloc(sizeof(uint64_t) * st->words);
+	st->job = malloc(sizeof(int) * servers);
+	st->cls = malloc(sizeof(int) * servers);
+	st->arrive_t = malloc(sizeof(int) * servers);
+	st->start_work = malloc(sizeof(int) * servers);
+	st->fin_t = malloc(sizeof(int) * servers);
+	st->fin_key = malloc(sizeof(event_key_t) * servers);
+	st->busy_t = malloc(sizeof(int) * servers);
+	st->d_fin_t = NULL;
+	if (ipa) {
+		st->d_fin_t = calloc(servers * IPA_PARAMS, sizeof(double));
+	}
+
+	for (int k = 0; k < classes; k++) {
+		*(st->qs + k) = init_queue();
+	}
+	station_clear(st);
+
+	return st;
+}
+
+/* Empties the station, leaving every server idle with no busy time, as when it
+ * was made. Queue nodes are kept as spares to be reused */
+void station_clear(struct station * st)
+{
+	for (int k = 0; k < st->classes; k++) {
+		queue_clear(*(st->qs + k));
+	}
+	st->size = 0;
+	st->occupied = 0;
+
+	/* Every server starts idle. Bits past the last server stay clear so
+	 * they are never found */
+	for (int w = 0; w < st->words; w++) {
+		*(st->idle + w) = ~(uint64_t) 0;
+	}
+	if (st->servers % 64 != 0) {
+		*(st->idle + st->words - 1) = ((uint64_t) 1
+				<< (st->servers % 64)) - 1;
+	}
+
+	for (int i = 0; i < st->servers; i++) {
+		*(st->job + i) = -1;
+		*(st->cls + i) = 0;
+		*(st->arrive_t + i) = 0;
+		*(st->start_work + i) = 0;
+		*(st->fin_t + i) = 0;
+		*(st->fin_key + i) = EVENT_KEY_MAX;
+		*(st->busy_t + i) = 0;
+	}
+	if (st->d_fin_t != NULL) {
+		for (int i = 0; i < st->servers * IPA_PARAMS; i++) {
+			*(st->d_fin_t + i) = 0;
+		}
+	}
+}
+
+/* Function to free a station */
+void kill_station(struct station * st)
+{
+	for (int k = 0; k < st->classes; k++) {
+		kill_queue(*(st->qs + k));
+	}
+	free(st->qs);
+	free(st->idle);
+	free(st->job);
+	free(st->cls);
+	free(st->arrive_t);
+	free(st->start_work);
+	free(st->fin_t);
+	free(st->fin_key);
+	free(st->busy_t);
+	free(st->d_fin_t);
+	free(st);
+}
+
+/* Returns the lowest numbered idle server, or -1 if every server is busy */
+int station_idle_server(struct station * st)
+{
+	for (int w = 0; w < st->words; w++) {
+		uint64_t bits = *(st->idle + w);
+		if (bits != 0) {
+			return w * 64 + __builtin_ctzll(bits);
+		}
+	}
+	return -1;
+}
+
+/* Starts serving job, of class cls, at an idle server at time t. arrive_t is
+ * when the job arrived at the station, which may be earlier if it had to wait.
+ */
+void station_start(struct station * st, int server, int job, int cls,
+		int arrive_t, int t)
+{
+	*(st->idle + server / 64) &= ~((uint64_t) 1 << (server % 64));
+	*(st->job + server) = job;
+	*(st->cls + server) = cls;
+	*(st->arrive_t + server) = arrive_t;
+	*(st->start_work + server) = t;
+}
+
+/* Sends job, of class cls, to the station at time t. If a server is idle the
+ * job starts service there and that server is returned. Otherwise the job joins
+ * the queue of its class, keeping its service demand for when it is served, and
+ * -1 is returned.
+ */
+int station_arrive(struct station * st, int job, int cls, int demand, int t)
+{
+	st->size++;
+
+	int server = station_idle_server(st);
+	if (server != -1) {
+		station_start(st, server, job, cls, t, t);
+		return server;
+	}
+
+	struct queue * q = *(st->qs + cls);
+	queue_push(q, t, job);
+	q->tail->demand = demand;
+	st->occupied |= (uint32_t) 1 << cls;
+	return -1;
+}
+
+/* Finishes the job at server at time t, leaving the server idle. Returns how
+ * long the server spent on the job.
+ */
+int station_finish(struct station * st, int server, int t)
+{
+	int work = t - *(st->start_work + server);
+
+	*(st->idle + server / 64) |= (uint64_t) 1 << (server % 64);
+	*(st->job + server) = -1;
+	*(st->busy_t + server) += work;
+	st->size--;
+
+	return work;
+}
+
+/* Starts the waiting job of the highest priority class that has waited longest
+ * on server, which must be idle, at time t. Returns the job's queue node, which
+ * the caller gives back to the queue of the job's class with queue_recycle once
+ * done with it, or NULL if no job is waiting.
+ */
+struct node * station_next(struct station * st, int server, int t)
+{
+	if (st->occupied == 0) {
+		return NULL;
+	}
+
+	int cls = __builtin_ctz(st->occupied);
+	struct queue * q = *(st->qs + cls);
+	struct node * retval = queue_pop(q);
+	if (queue_is_empty(q)) {
+		st->occupied &= ~((uint32_t) 1 << cls);
+	}
+
+	station_start(st, server, retval->job, cls, retval->time, t);
+	return retval;
+}
+
+/* Returns the server a job of class cls arriving at time t should preempt, or -1
+ * if it should not preempt any. Only when every server is busy is a job
+ * preempted, and then it is the job of the lowest priority class below cls that
+ * still has work left.
+ */
+int station_victim(struct station * st, int cls, int t)
+{
+	if (station_idle_server(st) != -1) {
+		return -1;
+	}
+
+	int retval = -1;
+	int victim_cls = cls;
+	for (int i = 0; i < st->servers; i++) {
+		if (*(st->cls + i) > victim_cls && *(st->fin_t + i) > t) {
+			retval = i;
+			victim_cls = *(st->cls + i);
+		}
+	}
+	return retval;
+}
+
+/* Stops the job at server at time t and puts it back at the head of its class's
+ * queue, with the work it has left as its demand, so it resumes where it left
+ * off. The job stays at the station, and its finish event is left to be ignored
+ * when it comes up. Returns how long the server spent on the job.
+ */
+int station_preempt(struct station * st, int server, int t)
+{
+	int work = t - *(st->start_work + server);
+	int cls = *(st->cls + server);
+	struct queue * q = *(st->qs + cls);
+
+	queue_push_front(q, *(st->arrive_t + server), *(st->job + server));
+	q->head->demand = *(st->fin_t + server) - t;
+	st->occupied |= (uint32_t) 1 << cls;
+
+	*(st->idle + server / 64) |= (uint64_t) 1 << (server % 64);
+	*(st->job + server) = -1;
+	*(st->busy_t + server) += work;
+
+	return work;
+}
+
+/* Starts the busy time of every server over from time t. Servers in the middle
+ * of a job only count the part of it done after t.
+ */
+void station_reset_stats(struct station * st, int t)
+{
+	for (int i = 0; i < st->servers; i++) {
+		*(st->busy_t + i) = 0;
+		if (*(st->job + i) != -1) {
+			*(st->busy_t + i) = *(st->start_work + i) - t;
+		}
+	}
+}
+
+/* Creates room up front in the queue of every class for n waiting jobs */
+void station_reserve(struct station * st, int n)
+{
+	for (int k = 0; k < st->classes; k++) {
+		queue_reserve(*(st->qs + k), n);
+	}
+}
+
+/* Adds the finish event key of every server to kw, so the keys follow their
+ * events when the scheduler renumbers them */
+void station_watch(struct station * st, struct key_watch * kw)
+{
+	for (int i = 0; i < st->servers; i++) {
+		watch_key(kw, st->fin_key + i);
+	}
+}
+
+/* Returns the busy time of all servers added together */
+int station_tot_busy_t(struct station * st)
+{
+	int retval = 0;
+	for (int i = 0; i < st->servers; i++) {
+		retval += *(st->busy_t + i);
+	}
+	return retval;
+}
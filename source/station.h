@@ -0,0 +1,50 @@
+#ifndef STATION_H
+#define STATION_H
+
+#include <stdint.h>
+
+/* A service station made up of identical servers. Waiting jobs are kept in one
+ * FIFO queue per job class, with a bit set in occupied for every class that has
+ * jobs waiting, so the highest priority waiting job (lowest class) is found with
+ * one find first set. Idle servers are tracked the same way, in a bitmap with
+ * one bit per server set while the server is idle.
+ */
+struct station
+{
+	const char * name;
+	struct queue ** qs;	// Jobs waiting for a server, one queue per class
+	int classes;		// Number of job classes
+	uint32_t occupied;	// Bit k set while class k has jobs waiting
+	int servers;		// Number of servers
+	int words;		// Number of 64 bit words in idle
+	uint64_t * idle;	// Bitmap of idle servers
+	int * job;		// Job being served by each server
+	int * cls;		// Class of the job being served by each server
+	int * arrive_t;		// Time the served job arrived at the station
+	int * start_work;	// Time each server started its current job
+	int * fin_t;		// Time each server will finish its current job
+	event_key_t * fin_key;	// Key of the finish event of each server's job
+	int * busy_t;		// Total time each server has been busy
+	double * d_fin_t;	// Derivatives of fin_t, IPA_PARAMS per server,
+				// NULL without IPA
+	int size;		// Jobs at the station, waiting or being served
+};
+
+struct station * init_station(const char * name, int servers, int classes,
+		bool ipa);
+void kill_station(struct station * st);
+void station_clear(struct station * st);
+int station_idle_server(struct station * st);
+void station_start(struct station * st, int server, int job, int cls,
+		int arrive_t, int t);
+int station_arrive(struct station * st, int job, int cls, int demand, int t);
+int station_finish(struct station * st, int server, int t);
+struct node * station_next(struct station * st, int server, int t);
+int station_victim(struct station * st, int cls, int t);
+int station_preempt(struct station * st, int server, int t);
+int station_tot_busy_t(struct station * st);
+void station_reset_stats(struct station * st, int t);
+void station_reserve(struct station * st, int n);
+void station_watch(struct station * st, struct key_watch * kw);
+
+#endif /* not defined STATION_H */
@@ -0,0 +1,151 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include "min_heap.h"
+#include "tourney.h"
+
+/* Key of an empty slot, after every event */
+#define EMPTY_KEY EVENT_KEY_MAX
+
+static void replay(struct tourney * tt, int source);
+static void renumber(struct tourney * tt);
+static int cmp_slot_key(const void * a, const void * b);
+
+/* Function to create a tournament over the given number of sources, all with
+ * nothing pending */
+struct tourney * init_tourney(int sources)
+{
+	struct tourney * tt = malloc(sizeof(struct tourney));
+	tt->sources = sources;
+	tt->leaves = 1;
+	while (tt->leaves < sources) {
+		tt->leaves *= 2;
+	}
+	tt->slots = malloc(sizeof(struct event) * tt->leaves);
+	tt->tree = malloc(sizeof(int) * tt->leaves * 2);
+	init_key_watch(&tt->watch);
+	tourney_clear(tt);
+
+	return tt;
+}
+
+/* Drops every pending event, leaving all slots empty as when the tournament
+ * was made */
+void tourney_clear(struct tourney * tt)
+{
+	tt->size = 0;
+	tt->seq = 0;
+	for (int i = 0; i < tt->leaves; i++) {
+		(tt->slots + i)->key = EMPTY_KEY;
+		*(tt->tree + tt->leaves + i) = i;
+	}
+	for (int n = tt->leaves - 1; n >= 1; n--) {
+		*(tt->tree + n) = *(tt->tree + n * 2);
+	}
+}
+
+/* Function to free a tournament */
+void kill_tourney(struct tourney * tt)
+{
+	free(tt->slots);
+	free(tt->tree);
+	kill_key_watch(&tt->watch);
+	free(tt);
+}
+
+/* Puts an event for job, of type, at time into the slot of source, which must
+ * have nothing pending, and returns the key it is stamped with. Keys are given
+ * in push order as by heap_push, so events come out in the same order as from
+ * the heap.
+ */
+event_key_t tourney_push(struct tourney * tt, int source, int time, int job,
+		int type)
+{
+	/* A second event from the same source would overwrite the first */
+	if ((tt->slots + source)->key != EMPTY_KEY) {
+		fprintf(stderr, "Error: Source %d already has an event pending\n",
+				source);
+		exit(1);
+	}
+	if (tt->seq == EVENT_SEQ_LIMIT) {
+		renumber(tt);
+	}
+
+	struct event * e = tt->slots + source;
+	e->time = time;
+	e->job = job;
+	e->type = type;
+	e->key = event_key(time, tt->seq++);
+	tt->size++;
+
+	replay(tt, source);
+	return e->key;
+}
+
+/* Takes the earliest pending event out of its slot and returns it. The event is
+ * copied out first, so the slot can take a new event while it is handled, and
+ * stays valid until the next pop.
+ */
+struct event * tourney_pop(struct tourney * tt)
+{
+	int source = *(tt->tree + 1);
+	tt->popped = *(tt->slots + source);
+	(tt->slots + source)->key = EMPTY_KEY;
+	tt->size--;
+
+	replay(tt, source);
+	return &tt->popped;
+}
+
+bool tourney_is_empty(struct tourney * tt)
+{
+	return tt->size == 0;
+}
+
+/* Replays the matches from the slot of source up to the root after its key
+ * changed */
+static void replay(struct tourney * tt, int source)
+{
+	for (int n = (tt->leaves + source) / 2; n >= 1; n /= 2) {
+		int a = *(tt->tree + n * 2);
+		int b = *(tt->tree + n * 2 + 1);
+		*(tt->tree + n) = (tt->slots + b)->key < (tt->slots + a)->key
+				? b : a;
+	}
+}
+
+/* Gives the pending events new sequence numbers counting up from 0 in key
+ * order, as heap_renumber does, so they keep their order and no match needs to
+ * be replayed. Keys in the watch follow their events.
+ */
+static void renumber(struct tourney * tt)
+{
+	struct event ** pending = malloc(sizeof(struct event *) * tt->size);
+	int n = 0;
+	for (int i = 0; i < tt->sources; i++) {
+		if ((tt->slots + i)->key != EMPTY_KEY) {
+			*(pending + n) = tt->slots + i;
+			n++;
+		}
+	}
+	qsort(pending, n, sizeof(struct event *), cmp_slot_key);
+
+	remap_begin(&tt->watch);
+	tt->seq = 0;
+	for (int i = 0; i < n; i++) {
+		struct event * e = *(pending + i);
+		event_key_t key = event_key(e->time, tt->seq++);
+		remap_key(&tt->watch, e->key, key);
+		e->key = key;
+	}
+	remap_end(&tt->watch);
+	free(pending);
+}
+
+/* Orders pointers to slots by key for qsort */
+static int cmp_slot_key(const void * a, const void * b)
+{
+	event_key_t ka = (*(struct event * const *) a)->key;
+	event_key_t kb = (*(struct event * const *) b)->key;
+	return (ka > kb) - (ka < kb);
+}
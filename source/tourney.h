@@ -0,0 +1,34 @@
+#ifndef TOURNEY_H
+#define TOURNEY_H
+
+#include <stdint.h>
+
+/* Pending events of a model where every event comes from one of a fixed set of
+ * sources, each with at most one event pending at a time, such as a server and
+ * its next finish. Each source has its own slot, and the earliest slot is kept
+ * by a tournament tree over the slots. Each inner node holds the slot that won
+ * the match between its two children, so the root holds the earliest, and an
+ * event is pushed or popped by replaying the matches on the path from its slot
+ * to the root, with no allocation. Empty slots hold a key later than any event.
+ */
+struct tourney
+{
+	struct event * slots;	// Pending event of each source
+	int * tree;		// Winner of each match, slot i is leaf leaves + i
+	int sources;		// Number of sources
+	int leaves;		// Sources rounded up to a power of two
+	int size;		// Number of pending events
+	uint32_t seq;		// Sequence number of the next push
+	struct event popped;	// Last event popped
+	struct key_watch watch;	// Keys held by the caller, kept when renumbered
+};
+
+struct tourney * init_tourney(int sources);
+void kill_tourney(struct tourney * tt);
+void tourney_clear(struct tourney * tt);
+event_key_t tourney_push(struct tourney * tt, int source, int time, int job,
+		int type);
+struct event * tourney_pop(struct tourney * tt);
+bool tourney_is_empty(struct tourney * tt);
+
+#endif /* not defined TOURNEY_H */
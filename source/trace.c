@@ -0,0 +1,167 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "trace.h"
+
+/* Number of records in one readahead window (1 MiB worth of records) */
+#define TRACE_WINDOW (1 << 16)
+
+static void advise_window(struct trace * tr, uint64_t w, int advice);
+
+/* Function to map a trace file and prepare it to be read lazily. Only the
+ * header is touched here, so this returns immediately no matter how large the
+ * trace is. Records before init_time are refused as they are popped.
+ */
+struct trace * init_trace(const char * path, int init_time)
+{
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		fprintf(stderr, "Error: Trace file %s not found, exiting\n",
+				path);
+		exit(1);
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) < 0
+			|| st.st_size < (off_t) sizeof(struct trace_header)) {
+		fprintf(stderr, "Error: Trace file %s is truncated\n", path);
+		exit(1);
+	}
+
+	unsigned char * map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE,
+			fd, 0);
+	if (map == MAP_FAILED) {
+		fprintf(stderr, "Error: Could not map trace file %s\n", path);
+		exit(1);
+	}
+
+	struct trace_header * header = (struct trace_header *) map;
+	uint64_t room = (st.st_size - sizeof(struct trace_header))
+			/ sizeof(struct trace_record);
+	if (memcmp(header->magic, TRACE_MAGIC, sizeof(header->magic)) != 0) {
+		fprintf(stderr, "Error: %s is not a trace file\n", path);
+		exit(1);
+	} else if (header->count > room) {
+		fprintf(stderr, "Error: Trace file %s is truncated\n", path);
+		exit(1);
+	}
+
+	struct trace * tr = malloc(sizeof(struct trace));
+	tr->fd = fd;
+	tr->map = map;
+	tr->map_len = st.st_size;
+	tr->recs = (const struct trace_record *)
+			(map + sizeof(struct trace_header));
+	tr->count = header->count;
+	tr->next = 0;
+	tr->window = 0;
+	tr->last_time = init_time;
+
+	/* Records are only ever read front to back */
+	madvise(map, st.st_size, MADV_SEQUENTIAL);
+	advise_window(tr, 0, MADV_WILLNEED);
+	advise_window(tr, 1, MADV_WILLNEED);
+
+	return tr;
+}
+
+/* Function to unmap and free a trace */
+void kill_trace(struct trace * tr)
+{
+	munmap(tr->map, tr->map_len);
+	close(tr->fd);
+	free(tr);
+}
+
+/* Applies advice to the pages holding the records of window w. The range is
+ * shrunk to whole pages so that neighbouring windows are never affected.
+ */
+static void advise_window(struct trace * tr, uint64_t w, int advice)
+{
+	uint64_t page = sysconf(_SC_PAGESIZE);
+	uint64_t first = w * TRACE_WINDOW;
+	uint64_t last = first + TRACE_WINDOW;
+
+	if (first >= tr->count) {
+		return;
+	}
+	if (last > tr->count) {
+		last = tr->count;
+	}
+
+	uint64_t start = sizeof(struct trace_header)
+			+ first * sizeof(struct trace_record);
+	uint64_t end = sizeof(struct trace_header)
+			+ last * sizeof(struct trace_record);
+
+	/* WILLNEED may round outwards, DONTNEED must round inwards */
+	if (advice == MADV_WILLNEED) {
+		start -= start % page;
+	} else {
+		start += (page - start % page) % page;
+		end -= end % page;
+	}
+	if (start >= end) {
+		return;
+	}
+
+	madvise(tr->map + start, end - start, advice);
+}
+
+/* Returns the next record of the trace and advances past it. Whenever a new
+ * window is entered, readahead is requested for the window after it and the
+ * pages of the window two behind are released, so resident memory stays a few
+ * windows wide however large the trace is.
+ */
+const struct trace_record * trace_pop(struct trace * tr)
+{
+	/* Returns error if trace is already empty */
+	if (tr->next >= tr->count) {
+		fprintf(stderr, "Attempted to pop from an empty trace\n");
+		exit(1);
+	}
+
+	const struct trace_record * retval = tr->recs + tr->next;
+	if (retval->time < tr->last_time && tr->next == 0) {
+		fprintf(stderr, "Error: Trace record 0 is before INIT_TIME\n");
+		exit(1);
+	} else if (retval->time < tr->last_time) {
+		fprintf(stderr, "Error: Trace record %llu is out of order\n",
+				(unsigned long long) tr->next);
+		exit(1);
+	}
+	tr->last_time = retval->time;
+	tr->next++;
+
+	uint64_t w = tr->next / TRACE_WINDOW;
+	if (w != tr->window) {
+		tr->window = w;
+		advise_window(tr, w + 1, MADV_WILLNEED);
+		if (w >= 2) {
+			advise_window(tr, w - 2, MADV_DONTNEED);
+		}
+	}
+
+	return retval;
+}
+
+const struct trace_record * trace_peek(struct trace * tr)
+{
+	if (tr->next >= tr->count) {
+		return NULL;
+	}
+	return tr->recs + tr->next;
+}
+
+bool trace_is_empty(struct trace * tr)
+{
+	if (tr->next >= tr->count) {
+		return true;
+	}
+	return false;
+}
@@ -0,0 +1,45 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+
+/* Magic bytes found at the start of every trace file */
+#define TRACE_MAGIC "DESTRACE"
+
+/* Layout of a trace file on disk. The file is a trace_header followed by
+ * header.count trace_records, sorted by time. All values are stored in the
+ * native byte order of the machine running the simulation.
+ */
+struct trace_header
+{
+	char magic[8];
+	uint64_t count;
+};
+
+struct trace_record
+{
+	int32_t time;		// Time the job arrives
+	int32_t job_class;	// Class of the job
+	int32_t demand;		// Service demand at the cpu, 0 to draw from config
+	int32_t reserved;	// Unused, keeps records 16 bytes wide
+};
+
+struct trace
+{
+	int fd;
+	unsigned char * map;	// Start of the mapping
+	uint64_t map_len;	// Length of the mapping in bytes
+	const struct trace_record * recs;
+	uint64_t count;		// Number of records in the trace
+	uint64_t next;		// Index of the next record to be popped
+	uint64_t window;	// Window readahead was last requested for
+	int last_time;		// Time of the last record popped, or INIT_TIME
+};
+
+struct trace * init_trace(const char * path, int init_time);
+void kill_trace(struct trace * tr);
+const struct trace_record * trace_pop(struct trace * tr);
+const struct trace_record * trace_peek(struct trace * tr);
+bool trace_is_empty(struct trace * tr);
+
+#endif /* not defined TRACE_H */
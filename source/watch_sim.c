@@ -0,0 +1,54 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include "metrics.h"
+
+/* Watches a running simulation through the shared memory segment named by its
+ * METRICS_SHM config value, printing a line of progress every interval until
+ * the simulation finishes.
+ *
+ * Usage: watch_sim name [interval in ms]
+ */
+int main(int argc, char ** argv)
+{
+	if (argc < 2) {
+		fprintf(stderr, "Usage: %s name [interval in ms]\n", argv[0]);
+		exit(1);
+	}
+
+	int interval = 1000;
+	if (argc >= 3) {
+		interval = atoi(argv[2]);
+	}
+
+	struct metrics * m = open_metrics(argv[1]);
+	struct metrics_snapshot snap;
+
+	printf("%10s %6s %12s %12s %6s %6s %6s %7s %7s %7s %12s\n",
+			"time", "done", "events", "events/s", "cpu", "disk1",
+			"disk2", "cpu%", "disk1%", "disk2%", "avg in sys");
+	while (true) {
+		metrics_read(m, &snap);
+
+		double span = snap.fin_time - snap.init_time;
+		double done = span > 0 ? (snap.time - snap.init_time) / span : 0;
+		printf("%10d %5.1lf%% %12lld %12.0lf %6d %6d %6d %6.1lf%% %6.1lf%% %6.1lf%% %12.3lf\n",
+				snap.time, done * 100, snap.events,
+				snap.events_per_sec, snap.cpu_size, snap.d1_size,
+				snap.d2_size, snap.cpu_util * 100,
+				snap.d1_util * 100, snap.d2_util * 100,
+				snap.avg_sojourn_t);
+		fflush(stdout);
+
+		if (snap.finished) {
+			printf("Simulation %d finished after %.3lf s\n", snap.pid,
+					snap.wall_sec);
+			break;
+		}
+		usleep(interval * 1000);
+	}
+
+	kill_metrics(m);
+	return 0;
+}